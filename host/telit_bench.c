@@ -0,0 +1,541 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telit.h"
+#include "telit_sim.h"
+
+/*
+* Measures the SDK against the simulated modem, and writes every result as
+* a JSON line, so that they can be compared from build to build:
+*
+*   {"bench":"parser","value":412.5,"unit":"MB/s","allocs_per_op":0,"optimized":true}
+*
+* Real time is measured for the work of the CPU, the clock of the
+* simulation for what the modem makes wait. allocs_per_op is -1 where the
+* heap calls can't be counted.
+*
+* Usage: telit_bench [latency_ms] [publish_count] [results_file]
+*
+* The results are also written to the file, without the messages of the SDK.
+*/
+
+// The boot of the firmware: main() waits for the console at most this
+// long, none is opened here; the modem answers this long after the power-up.
+#define BOOT_USB_WAIT_MS    2000
+#define BOOT_MODEM_MS       3000
+#define BOOT_READY_WAIT_MS  20000
+
+// The speeds of the line of the firmware, and the fastest the wiring of the bench carries.
+#define LINE_BAUDRATES      { 115200, 230400, 460800, 921600 }
+#define LINE_MAX_BAUDRATE   460800
+
+static char topic[] = "channels/1708249/publish";
+static char payload[] = "field1=500&status=MQTTPUBLISH";
+
+// What the benchmarks produce; it keeps the compiler from dropping the work.
+static volatile uint32_t sink;
+static FILE* results_file = NULL;
+static uint32_t failures = 0;          // Benchmarks whose work failed, they make the exit code 1.
+
+#ifdef TELIT_BENCH_WRAP_MALLOC
+// The linker sends the heap calls of the SDK and of this file here.
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+static uint64_t allocations = 0;
+
+void* __wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+static double allocations_per(uint64_t since, uint64_t operations) {
+    return (operations > 0) ? (double) (allocations - since) / operations : 0;
+}
+#else
+// The heap calls are not counted, e.g. on a linker without --wrap.
+static const uint64_t allocations = 0;
+
+static double allocations_per(uint64_t since, uint64_t operations) {
+    return -1;
+}
+#endif
+
+static double now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static void report(const char* bench, double value, const char* unit, double allocs_per_op) {
+    #ifdef __OPTIMIZE__
+        const char* optimized = "true";
+    #else
+        const char* optimized = "false";
+    #endif
+
+    char line[160];
+    snprintf(line, sizeof(line), "{\"bench\":\"%s\",\"value\":%.3f,\"unit\":\"%s\",\"allocs_per_op\":%.3f,\"optimized\":%s}\n",
+             bench, value, unit, allocs_per_op, optimized);
+
+    fputs(line, stdout);
+    if (results_file != NULL) fputs(line, results_file);
+}
+
+static void on_parser_event(const telit_event_t* event, void* user) {
+    sink += event->type + event->field_count;
+}
+
+/**
+ * @brief Feeds the answers of a session to the parser, in the 64-byte
+ * bursts the UART gives them in.
+ */
+static void bench_parser(uint32_t iterations) {
+    static const char stream[] =
+        "AT+CSQ\r\r\n+CSQ: 18,0\r\n\r\nOK\r\n"
+        "AT+CREG?\r\r\n+CREG: 0,1\r\n\r\nOK\r\n"
+        "AT#SGACT=1,1\r\r\n#SGACT: 10.64.12.7\r\n\r\nOK\r\n"
+        "#MQRING: 1,1,channels/1708249/subscribe/fields/field1,29\r\n"
+        "+CGREG: 1\r\n"
+        "AT#MQPUBS=1,channels/1708249/publish,0,0,field1=500&status=MQTTPUBLISH\r\r\nOK\r\n"
+        "AT#MQREAD?\r\r\n#MQREAD: 1,3,2,0,0\r\n\r\nOK\r\n"
+        "AT+CME\r\r\n+CME ERROR: 30\r\n";
+
+    telit_parser_t parser;
+    telit_parser_init(&parser, on_parser_event, NULL);
+
+    uint64_t allocations_before = allocations;
+    double started_ns = now_ns();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (size_t offset = 0; offset < sizeof(stream) - 1; offset += 64) {
+            size_t length = (sizeof(stream) - 1 - offset < 64) ? sizeof(stream) - 1 - offset : 64;
+            telit_parser_feed(&parser, (const uint8_t*) stream + offset, length);
+        }
+    }
+
+    double elapsed_ns = now_ns() - started_ns;
+    double bytes = (double) iterations * (sizeof(stream) - 1);
+    report("parser", bytes / elapsed_ns * 1e3, "MB/s", allocations_per(allocations_before, iterations));
+}
+
+/**
+ * @brief Writes the #MQPUBS line of a publish with the command builder.
+ */
+static void bench_cmd_build(uint32_t iterations) {
+    char line[TELIT_COMMAND_SIZE];
+    telit_cmd_t cmd;
+
+    uint64_t allocations_before = allocations;
+    double started_ns = now_ns();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBS);
+        telit_cmd_arg_uint(&cmd, 1);
+        telit_cmd_arg(&cmd, topic);
+        telit_cmd_arg(&cmd, "0,0");
+        telit_cmd_arg(&cmd, payload);
+        telit_cmd_end(&cmd);
+        sink += cmd.length;
+    }
+
+    double elapsed_ns = now_ns() - started_ns;
+    report("cmd_build", elapsed_ns / iterations, "ns/op", allocations_per(allocations_before, iterations));
+}
+
+/**
+ * @brief Runs +CSQ queries against a modem which answers at once, so only
+ * the work of the SDK and of the simulation is left.
+ */
+static void bench_commands(uint32_t iterations) {
+    static telit_sim_t sim;
+    telit_sim_init(&sim);
+    sim.latency_ms = 0;
+    sim.baudrate = 0;
+    telit_sim_attach(&sim);
+
+    telit_query_result_t answer;
+    uint32_t failed = 0;
+
+    uint64_t allocations_before = allocations;
+    double started_ns = now_ns();
+
+    for (uint32_t i = 0; i < iterations; i++)
+        if (telit_query(TELIT_QUERY_SIGNAL, NULL, &answer)) failed++;
+
+    double elapsed_ns = now_ns() - started_ns;
+    report("commands", iterations / elapsed_ns * 1e9, "commands/s", allocations_per(allocations_before, iterations));
+    if (failed > 0) {
+        report("commands_failed", failed, "commands", 0);
+        failures++;
+    }
+}
+
+// The bring-up of the session, as start_mqtt() of the firmware.
+static bool start_mqtt() {
+    return process_mqtt_enable(false, "mqtt3.thingspeak.com", "1883")
+        || process_mqtt_login("NzsNHSIHKy40Jx8AKSIfHg8", "NzsNHSIHKy40Jx8AKSIfHg8", "WIr4lWLSISAqwDL8fOuRp0Nk")
+        || mqtt_subscribe_topic("channels/1708249/subscribe/fields/field1");
+}
+
+/**
+ * @brief Follows main() and modem_core_main() of the firmware from the
+ * power-up to the first publish, on the clock of the simulation. The
+ * modem is silent for its first BOOT_MODEM_MS.
+ */
+static void bench_boot(uint32_t latency_ms) {
+    static telit_sim_t sim;
+    telit_sim_init(&sim);
+    sim.latency_ms = latency_ms;
+    sim.boot_ms = BOOT_MODEM_MS;
+    telit_sim_attach(&sim);
+
+    uint64_t allocations_before = allocations;
+    uint64_t started_us = telit_now_us();
+
+    // The modem is probed until it answers, as modem_core_main() does.
+    telit_sleep_ms(BOOT_USB_WAIT_MS);
+    bool is_failed = telit_wait_ready(BOOT_READY_WAIT_MS);
+    uint64_t modem_us = telit_now_us();
+
+    telit_attach_t network;
+    telit_attach_init(&network, "super", NULL, NULL);
+    telit_attach_start(&network);
+    is_failed = is_failed || enable_registration_reports();
+
+    // The engine steps the bring-up, and sleeps until something comes.
+    while (!is_failed && telit_attach_step(&network) != TELIT_ATTACH_READY) {
+        telit_poll();
+        telit_wait_ms(TELIT_ENGINE_IDLE_MS);
+    }
+
+    is_failed = is_failed || start_mqtt() || mqtt_publish(topic, payload);
+    uint64_t published_us = telit_now_us();
+
+    if (is_failed) {
+        report("boot_failed", 1, "boots", 0);
+        failures++;
+        return;
+    }
+
+    report("boot_modem_ready", (modem_us - started_us) / 1000.0, "ms", 0);
+    report("boot_to_first_publish", (published_us - started_us) / 1000.0, "ms", allocations_per(allocations_before, 1));
+    report("attach_to_first_publish", (published_us - modem_us) / 1000.0, "ms", allocations_per(allocations_before, 1));
+    report("boot_commands", sim.commands, "commands", 0);
+}
+
+/**
+ * @brief Reboots the board, not the modem, after a session is up, and
+ * follows the firmware from there to the first publish: the context and
+ * the MQTT session of the modem are found, so only the subscription is
+ * made again. The MQTT settings are then written again, as they are.
+ */
+static void bench_warm_reconnect(uint32_t latency_ms) {
+    static telit_sim_t sim;
+    telit_sim_init(&sim);
+    sim.latency_ms = latency_ms;
+    telit_sim_attach(&sim);
+
+    telit_init_3g();
+    if (start_mqtt()) {
+        report("warm_reconnect_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+
+    uint32_t commands_before = sim.commands;
+    uint64_t allocations_before = allocations;
+    uint64_t started_us = telit_now_us();
+
+    telit_attach_t network;
+    telit_attach_init(&network, "super", NULL, NULL);
+    bool is_failed = telit_attach_resume(&network);
+
+    mqtt_session_t session = mqtt_session_state(false, "mqtt3.thingspeak.com", "1883");
+    is_failed = is_failed || session != MQTT_SESSION_CONNECTED
+        || mqtt_subscribe_topic("channels/1708249/subscribe/fields/field1") || mqtt_publish(topic, payload);
+
+    if (is_failed) {
+        report("warm_reconnect_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+
+    report("warm_reconnect_to_first_publish", (telit_now_us() - started_us) / 1000.0, "ms", allocations_per(allocations_before, 1));
+    report("warm_reconnect_commands", sim.commands - commands_before, "commands", 0);
+
+    // Every setting is as wanted already, they are only read.
+    started_us = telit_now_us();
+    if (mqtt_enable_and_configure(false, "mqtt3.thingspeak.com", "1883")) {
+        report("mqtt_configure_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+    report("mqtt_configure_unchanged", (telit_now_us() - started_us) / 1000.0, "ms", 0);
+}
+
+/**
+ * @brief Steps the line up from 115200 baud as the firmware does at the
+ * boot, on wiring which breaks the bytes above LINE_MAX_BAUDRATE; the line
+ * has to fall back to it. Then a board which reboots, not the modem, finds
+ * the speed again.
+ */
+static void bench_baudrate(uint32_t latency_ms) {
+    static telit_sim_t sim;
+    telit_sim_init(&sim);
+    sim.latency_ms = latency_ms;
+    sim.baudrate = 115200;
+    sim.max_baudrate = LINE_MAX_BAUDRATE;
+    telit_sim_attach(&sim);
+
+    const uint32_t baudrates[] = LINE_BAUDRATES;
+    const uint8_t count = sizeof(baudrates) / sizeof(baudrates[0]);
+
+    uint64_t started_us = telit_now_us();
+    uint32_t baudrate = telit_negotiate_baudrate(baudrates, count, baudrates[0]);
+    uint64_t negotiated_us = telit_now_us();
+
+    // The board starts again at the default speed.
+    sim.board_baudrate = baudrates[0];
+    uint32_t found = telit_find_baudrate(baudrates, count);
+    uint64_t found_us = telit_now_us();
+
+    if (baudrate != LINE_MAX_BAUDRATE || found != baudrate) {
+        report("baudrate_failed", 1, "negotiations", 0);
+        failures++;
+        return;
+    }
+
+    report("baudrate_negotiated", baudrate, "baud", 0);
+    report("baudrate_negotiation", (negotiated_us - started_us) / 1000.0, "ms", 0);
+    report("baudrate_find", (found_us - negotiated_us) / 1000.0, "ms", 0);
+    report("baudrate_broken_bytes", sim.broken_bytes, "bytes", 0);
+}
+
+/**
+ * @brief Brings the session of the selected modem up on the simulated one.
+ */
+static bool bench_session(telit_sim_t* sim, uint32_t latency_ms) {
+    telit_sim_init(sim);
+    sim->latency_ms = latency_ms;
+    sim->loopback = false;
+    telit_sim_attach(sim);
+
+    telit_init_3g();
+    return start_mqtt();
+}
+
+/**
+ * @brief Publishes through the engines of the modems, each on its own
+ * simulated modem, as the modem core of a gateway with a SIM for every
+ * carrier does: the publishes go to the engines in turn, and the engines
+ * are stepped one after the other. The clocks of the modems go on together.
+ *
+ * @return double The publishes answered per second of the simulation.
+ */
+static double bench_engines_publish(telit_engine_t engines[], telit_sim_t* sims[], uint8_t count, uint32_t publishes) {
+    char command[TELIT_COMMAND_SIZE];
+    snprintf(command, sizeof(command), "#MQPUBS=1,%s,0,0,%s", topic, payload);
+
+    uint32_t submitted = 0, answered = 0, failed = 0;
+    uint64_t started_us = sims[0]->now_us;
+
+    while (answered < publishes) {
+        for (uint8_t i = 0; i < count && submitted < publishes; i++)
+            if (!telit_engine_submit(&engines[submitted % count], command, TELIT_MSG_WAIT_MS, submitted)) submitted++;
+
+        for (uint8_t i = 0; i < count; i++) {
+            telit_engine_step(&engines[i]);
+
+            telit_engine_response_t response;
+            while (!telit_engine_take(&engines[i], &response)) {
+                if (response.result != TELIT_RESULT_OK) failed++;
+                answered++;
+            }
+        }
+
+        for (uint8_t i = 0; i < count; i++)
+            telit_sim_advance(sims[i], 1000);
+    }
+
+    if (failed > 0) {
+        report("engines_publish_failed", failed, "publishes", 0);
+        failures++;
+    }
+    return answered / ((sims[0]->now_us - started_us) / 1e6);
+}
+
+/**
+ * @brief Splits the publishes across two modems, the default one and a
+ * second on its own line, against one modem alone.
+ */
+static void bench_two_modems(uint32_t latency_ms, uint32_t count) {
+    static telit_sim_t first_sim, second_sim;
+    static telit_modem_t second;
+    static telit_engine_t engines[2];
+    telit_sim_t* sims[2] = { &first_sim, &second_sim };
+
+    bool is_failed = bench_session(&first_sim, latency_ms);
+    telit_engine_init(&engines[0], NULL, NULL, NULL);
+
+    telit_modem_init(&second, NULL);
+    telit_modem_t* selected = telit_select(&second);
+    is_failed = is_failed || bench_session(&second_sim, latency_ms);
+    telit_engine_init(&engines[1], NULL, NULL, NULL);
+    telit_select(selected);
+
+    if (is_failed) {
+        report("two_modems_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+
+    double one = bench_engines_publish(engines, sims, 1, count);
+    double two = bench_engines_publish(engines, sims, 2, count);
+
+    report("one_modem_publish", one, "publishes/s", 0);
+    report("two_modems_publish", two, "publishes/s", 0);
+    report("two_modems_speedup", one > 0 ? two / one : 0, "x", 0);
+}
+
+// The messages of a client of bench_two_clients(), and those which came to the wrong one.
+typedef struct client_inbox {
+    char*       topic;
+    uint32_t    messages;
+    uint32_t    misrouted;
+} client_inbox_t;
+
+static void on_client_message(const char* topic, const char* payload, uint16_t length, void* user) {
+    client_inbox_t* inbox = user;
+    inbox->messages++;
+    if (strcmp(topic, inbox->topic) != 0) inbox->misrouted++;
+}
+
+/**
+ * @brief Two MQTT clients of one modem, each subscribed to its own topic,
+ * publish in turn; the modem sends every publish back to the client which
+ * made it. Every message has to come to the handler of its client.
+ */
+static void bench_two_clients(uint32_t latency_ms, uint32_t count) {
+    static telit_sim_t sim;
+    static char first_topic[] = "channels/1708249/subscribe/fields/field1";
+    static char second_topic[] = "channels/1708249/subscribe/fields/field2";
+    client_inbox_t inboxes[2] = { { first_topic }, { second_topic } };
+
+    bool is_failed = bench_session(&sim, latency_ms);
+    sim.loopback = true;
+    mqtt_set_message_handler(on_client_message, &inboxes[0]);
+
+    uint8_t selected = mqtt_select(2);
+    is_failed = is_failed || process_mqtt_enable(false, "mqtt3.thingspeak.com", "1883")
+        || process_mqtt_login("NzsNHSIHKy40Jx8AKSIfHg8", "NzsNHSIHKy40Jx8AKSIfHg8", "WIr4lWLSISAqwDL8fOuRp0Nk")
+        || mqtt_subscribe_topic(inboxes[1].topic);
+    mqtt_set_message_handler(on_client_message, &inboxes[1]);
+    mqtt_select(selected);
+
+    if (is_failed) {
+        report("two_clients_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+
+    uint32_t published = 0;
+    uint64_t started_us = telit_now_us();
+
+    for (uint32_t i = 0; i < count; i++) {
+        selected = mqtt_select(1 + i % 2);
+        if (!mqtt_publish(topic, payload)) published++;
+        mqtt_select(selected);
+        mqtt_process_messages();
+    }
+    while (mqtt_announced_messages() > 0 && !mqtt_process_messages()) {}
+
+    double simulated_s = (telit_now_us() - started_us) / 1e6;
+    uint32_t messages = inboxes[0].messages + inboxes[1].messages;
+    uint32_t misrouted = inboxes[0].misrouted + inboxes[1].misrouted;
+
+    report("two_clients_publish", simulated_s > 0 ? published / simulated_s : 0, "publishes/s", 0);
+    report("two_clients_messages", messages, "messages", 0);
+    report("two_clients_misrouted", misrouted, "messages", 0);
+    if (published < count || messages < published || misrouted > 0) failures++;
+
+    for (uint8_t id = 1; id <= 2; id++) {
+        selected = mqtt_select(id);
+        mqtt_set_message_handler(NULL, NULL);
+        mqtt_select(selected);
+    }
+}
+
+/**
+ * @brief Publishes after the bring-up, at the latency of the modem.
+ */
+static void bench_publish(uint32_t latency_ms, uint32_t count) {
+    static telit_sim_t sim;
+    telit_sim_init(&sim);
+    sim.latency_ms = latency_ms;
+    sim.loopback = false;
+    telit_sim_attach(&sim);
+
+    telit_init_3g();
+    if (start_mqtt()) {
+        report("publish_failed", 1, "sessions", 0);
+        failures++;
+        return;
+    }
+
+    uint32_t published = 0;
+    uint64_t allocations_before = allocations;
+    uint64_t started_us = telit_now_us();
+    double started_ns = now_ns();
+
+    for (uint32_t i = 0; i < count; i++)
+        if (!mqtt_publish(topic, payload)) published++;
+
+    double elapsed_ns = now_ns() - started_ns;
+    double simulated_s = (telit_now_us() - started_us) / 1e6;
+    double allocs = allocations_per(allocations_before, count);
+
+    report("publish", simulated_s > 0 ? published / simulated_s : 0, "publishes/s", allocs);
+    report("publish_cpu", published / elapsed_ns * 1e9, "publishes/s", allocs);
+    if (published < count) {
+        report("publish_failed", count - published, "publishes", 0);
+        failures++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t latency_ms = (argc > 1) ? atoi(argv[1]) : 30;
+    uint32_t publish_count = (argc > 2) ? atoi(argv[2]) : 200;
+    if (argc > 3 && (results_file = fopen(argv[3], "w")) == NULL) {
+        printf("$> %s couldn't opened.\n", argv[3]);
+        return 1;
+    }
+
+    bench_parser(20000);
+    bench_cmd_build(1000000);
+    bench_commands(20000);
+    bench_boot(latency_ms);
+    bench_warm_reconnect(latency_ms);
+    bench_baudrate(latency_ms);
+    bench_publish(latency_ms, publish_count);
+    bench_two_modems(latency_ms, publish_count);
+    bench_two_clients(latency_ms, publish_count);
+
+    if (results_file != NULL) fclose(results_file);
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telit_cmd.h"
+#include "telit_trace.h"
+
+/*
+* Compares building a #MQPUBS command line with the command builder
+* against the heap and strcat path which the SDK used before, and the
+* trace event of the line against the debug message formatted for it.
+*
+* Usage: telit_cmd_bench [iterations]
+*/
+
+static const char topic[] = "channels/1708249/publish";
+static const char payload[] = "field1=500&status=MQTTPUBLISH";
+
+// What is written to the modem; it keeps the compiler from dropping the work.
+static volatile uint32_t sink;
+
+/**
+ * @brief The old create_message(): "AT" + command + CR+LF on the heap.
+ */
+static char* legacy_create_message(char* command) {
+    char* message_to_return = (char *) malloc(sizeof(char) * (strlen(command) + strlen("AT") + strlen("\r\n") + 1));
+    memset(message_to_return, '\0', sizeof(char) * (strlen(command) + strlen("AT") + strlen("\r\n") + 1));
+
+    strcat(message_to_return, "AT");
+    strcat(message_to_return, command);
+    strcat(message_to_return, "\r\n");
+
+    return message_to_return;
+}
+
+/**
+ * @brief The old mqtt_publish() up to the write of the line.
+ */
+static void legacy_publish(const char* topic_publish_address, const char* string_to_publish) {
+    const char prefix[] = "#MQPUBS=1,";
+    const char midfix[] = ",0,0,";
+
+    char* concat_message = (char *) malloc(sizeof(char) * (strlen(prefix) + strlen(topic_publish_address) + strlen(midfix) + strlen(string_to_publish) + 1));
+    memset(concat_message, '\0', sizeof(char) * (strlen(prefix) + strlen(topic_publish_address) + strlen(midfix) + strlen(string_to_publish) + 1));
+
+    strcat(concat_message, prefix);
+    strcat(concat_message, topic_publish_address);
+    strcat(concat_message, midfix);
+    strcat(concat_message, string_to_publish);
+
+    char* message_to_send = legacy_create_message(concat_message);
+    sink += strlen(message_to_send);
+
+    free(message_to_send);
+    free(concat_message);
+}
+
+static void builder_publish(const char* topic_publish_address, const char* string_to_publish) {
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBS);
+    telit_cmd_arg_uint(&cmd, 1);
+    telit_cmd_arg(&cmd, topic_publish_address);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg(&cmd, string_to_publish);
+    telit_cmd_end(&cmd);
+    sink += cmd.length;
+}
+
+static double now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// On the Pico the time of an event is a read of the timer; a counter stands
+// for it here, so the clock of the host is not measured.
+static uint64_t counter_now_us(void* user) {
+    return ++*(uint64_t*) user;
+}
+
+/**
+ * @brief What DETAILED_PRINT did for every line, without the time of the
+ * USB or the UART which printed it.
+ */
+static void debug_print_line(const char* line, const char* unused) {
+    char text[TELIT_COMMAND_LINE_SIZE + 32];
+    sink += snprintf(text, sizeof(text), "-- message is (%d byte) %s", (int) strlen(line), line);
+}
+
+static void trace_line(const char* line, const char* unused) {
+    TELIT_TRACE(AT, TELIT_TRACE_CMD_WRITE, 72, TELIT_TRACE_TAG("#MQPUBS"));
+
+    // Empty the ring without formatting, only the call site is measured here.
+    if (telit_trace_pending() == TELIT_TRACE_RING_SIZE)
+        telit_trace.tail = telit_trace.head;
+}
+
+static void count_trace_line(const char* line, uint16_t length, void* user) {
+    sink += length;
+}
+
+static double measure(void (*build)(const char*, const char*), uint32_t iterations) {
+    double started_ns = now_ns();
+    for (uint32_t i = 0; i < iterations; i++)
+        build(topic, payload);
+    return (now_ns() - started_ns) / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t iterations = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+    // Both have to build the same line.
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBS);
+    telit_cmd_arg_uint(&cmd, 1);
+    telit_cmd_arg(&cmd, topic);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg(&cmd, payload);
+    telit_cmd_end(&cmd);
+
+    char expected[TELIT_COMMAND_LINE_SIZE];
+    snprintf(expected, sizeof(expected), "AT#MQPUBS=1,%s,0,0,%s\r\n", topic, payload);
+    if (strcmp(line, expected) != 0) {
+        printf("$> The builder made: %s", line);
+        return 1;
+    }
+
+    // An argument may end with '=', e.g. a base64 user name, or be empty, as
+    // the user name for an anonymous broker; each one keeps its own field.
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQCONN);
+    telit_cmd_arg_uint(&cmd, 1);
+    telit_cmd_arg(&cmd, "pico");
+    telit_cmd_arg(&cmd, "dXNlcg==");
+    telit_cmd_arg(&cmd, "");
+    telit_cmd_arg(&cmd, "");
+    telit_cmd_end(&cmd);
+    if (strcmp(line, "AT#MQCONN=1,pico,dXNlcg==,,\r\n") != 0) {
+        printf("$> The builder made: %s", line);
+        return 1;
+    }
+
+    // Warm up the heap and the caches.
+    measure(legacy_publish, iterations / 10 + 1);
+    measure(builder_publish, iterations / 10 + 1);
+
+    double legacy_ns = measure(legacy_publish, iterations);
+    double builder_ns = measure(builder_publish, iterations);
+
+    printf("$> #MQPUBS line of %u bytes, %u iterations\n", cmd.length, iterations);
+    printf("$> malloc + strcat:   %8.1f ns/command\n", legacy_ns);
+    printf("$> telit_cmd builder: %8.1f ns/command (%.1fx)\n", builder_ns, legacy_ns / builder_ns);
+
+    uint64_t ticks = 0;
+    telit_port_t port = { .now_us = counter_now_us, .user = &ticks };
+    telit_set_port(&port);
+
+    measure(debug_print_line, iterations / 10 + 1);
+    measure(trace_line, iterations / 10 + 1);
+    double print_ns = measure(debug_print_line, iterations);
+    double trace_ns = measure(trace_line, iterations);
+
+    // The formatting is left to the drain, off the hot path.
+    telit_trace.tail = telit_trace.head;
+    for (uint32_t i = 0; i < TELIT_TRACE_RING_SIZE - 1; i++)
+        trace_line(line, NULL);
+    double started_ns = now_ns();
+    uint32_t drained = telit_trace_drain(0, 0, count_trace_line, NULL);
+    double drain_ns = (now_ns() - started_ns) / drained;
+
+    printf("$> debug message:     %8.1f ns/event\n", print_ns);
+    printf("$> trace event:       %8.1f ns/event (%.1fx), %.1f ns/event later in the drain\n", trace_ns,
+           print_ns / trace_ns, drain_ns);
+
+    return 0;
+}
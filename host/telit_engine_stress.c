@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telit.h"
+#include "telit_engine.h"
+#include "telit_sim.h"
+
+/*
+* Runs the modem engine on a thread of its own, as core1 of the firmware,
+* against the simulated modem, and floods it with commands and publishes
+* from the main thread, as core0. Every answer has to come back once, in
+* order, and every publish has to come back as a message.
+*
+* Usage: telit_engine_stress [requests] [publish_every]
+*/
+
+static telit_sim_t sim;
+static telit_engine_t engine;
+
+static double now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// The modem core: it brings the session up, then runs the engine.
+static void* modem_core(void* arg) {
+    telit_sim_attach(&sim);
+    telit_init_3g();
+
+    if (process_mqtt_enable(false, "mqtt3.thingspeak.com", "1883")
+        || process_mqtt_login("NzsNHSIHKy40Jx8AKSIfHg8", "NzsNHSIHKy40Jx8AKSIfHg8", "WIr4lWLSISAqwDL8fOuRp0Nk")
+        || mqtt_subscribe_topic("channels/1708249/subscribe/fields/field1"))
+        printf("$> MQTT couldn't started.\n");
+
+    telit_engine_run(&engine);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t request_count = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint32_t publish_every = (argc > 2) ? atoi(argv[2]) : 4;
+    if (publish_every == 0) publish_every = 1;
+
+    telit_sim_init(&sim);
+    sim.latency_ms = 30;
+    telit_engine_init(&engine, NULL, NULL, NULL);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, modem_core, NULL) != 0) {
+        printf("$> The modem core couldn't started.\n");
+        return 1;
+    }
+
+    uint32_t submitted = 0, answered = 0, publishes = 0, messages = 0;
+    uint32_t full = 0, out_of_order = 0, failed = 0, bad_messages = 0;
+    double started_ns = now_ns();
+    double answered_ns = 0;
+
+    // The application core: it never waits for the modem.
+    while (answered < request_count || messages + __atomic_load_n(&engine.lost_messages, __ATOMIC_ACQUIRE) < publishes) {
+        if (submitted < request_count) {
+            uint32_t token = submitted + 1;
+            bool is_full;
+            if (token % publish_every == 0) {
+                char payload[32];
+                snprintf(payload, sizeof(payload), "token=%u", token);
+                is_full = telit_engine_publish(&engine, "channels/1708249/subscribe/fields/field1", payload, token);
+                if (!is_full) publishes++;
+            }
+            else is_full = telit_engine_submit(&engine, "+CSQ", TELIT_MSG_WAIT_MS, token);
+
+            if (is_full) full++;
+            else submitted++;
+        }
+
+        telit_engine_response_t response;
+        while (!telit_engine_take(&engine, &response)) {
+            if (response.kind == TELIT_ENGINE_MESSAGE) {
+                unsigned token;
+                if (sscanf(response.text, "token=%u", &token) != 1 || token == 0 || token > submitted) bad_messages++;
+                messages++;
+                continue;
+            }
+
+            // The answers come in the order of the requests.
+            if (response.token != answered + 1) out_of_order++;
+            if (response.result != TELIT_RESULT_OK) failed++;
+            if (++answered == request_count) answered_ns = now_ns();
+        }
+
+        // Give up if the modem core hangs.
+        if (now_ns() - started_ns > 30e9) {
+            printf("$> Timed out: %u/%u answered, %u/%u messages.\n", answered, request_count, messages, publishes);
+            break;
+        }
+    }
+
+    telit_engine_stop(&engine);
+    pthread_join(thread, NULL);
+
+    double real_s = (answered_ns - started_ns) / 1e9;
+    printf("$> Engine: %u/%u requests answered in %.3f s (%.0f/s), %u retries on a full queue\n",
+           answered, request_count, real_s, real_s > 0 ? answered / real_s : 0.0, full);
+    printf("$> Answers: %u out of order, %u failed\n", out_of_order, failed);
+    printf("$> Messages: %u/%u came back, %u lost, %u broken\n", messages, publishes, engine.lost_messages, bad_messages);
+
+    return (answered == request_count && out_of_order == 0 && failed == 0 && bad_messages == 0) ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telit.h"
+#include "telit_ring.h"
+#include "telit_sim.h"
+#include "telit_store_file.h"
+
+/*
+* Runs the sequence of the firmware against the simulated modem,
+* and reports how long it takes on the clock of the simulation.
+*
+* Usage: telit_host [latency_ms] [publish_count] [trace_file] [capture_file]
+*
+* With a trace file, the trace events are written there for
+* telit_trace_decode, "-" skips it. With a capture file, the bytes on the UART are
+* written there for telit_replay.
+*
+* It exits with 1 when a message is short, broken or lost on the way.
+*/
+
+static telit_sim_t sim;
+static uint32_t delivered_bytes = 0;
+static FILE* trace_file = NULL;
+static uint32_t traced_events = 0;
+static FILE* capture_file = NULL;
+
+static void on_trace_line(const char* line, uint16_t length, void* user) {
+    if (trace_file != NULL) fwrite(line, 1, length, trace_file);
+}
+
+static void on_capture_data(const uint8_t* data, uint16_t length, void* user) {
+    fwrite(data, 1, length, capture_file);
+}
+
+// The firmware drains the trace when it is idle, here it is done between the steps.
+static void drain_trace() {
+    traced_events += telit_trace_drain((uint32_t) sim.now_us, 0, on_trace_line, NULL);
+    if (capture_file != NULL) telit_capture_drain(0, on_capture_data, NULL);
+}
+
+static void on_command(telit_result_t result, const telit_event_t* info, void* user) {
+    if (result == TELIT_RESULT_OK) (*(uint32_t*) user)++;
+}
+
+static uint32_t in_place_views = 0;
+
+static void on_message_view(const mqtt_message_view_t* message, void* user) {
+    const telit_ring_t* ring = telit_rx_ring();
+    (*(uint32_t*) user) += message->length;
+
+    // Payloads in one piece are given right from the RX ring.
+    if (message->payload >= ring->data && message->payload < ring->data + ring->mask + 1)
+        in_place_views++;
+}
+
+// A config blob of the given length, made up on the fly.
+static uint16_t blob_source(uint8_t* buffer, uint16_t size, uint32_t offset, void* user) {
+    for (uint16_t i = 0; i < size; i++)
+        buffer[i] = 'a' + (offset + i) % 26;
+    return size;
+}
+
+typedef struct blob_check {
+    uint32_t    bytes;
+    uint32_t    pieces;
+    uint32_t    mismatches;
+} blob_check_t;
+
+static void blob_sink(const uint8_t* data, uint16_t length, uint32_t offset, uint32_t total, void* user) {
+    blob_check_t* check = (blob_check_t*) user;
+    for (uint16_t i = 0; i < length; i++)
+        if (data[i] != 'a' + (offset + i) % 26) check->mismatches++;
+    check->bytes += length;
+    check->pieces++;
+}
+
+typedef struct frame_check {
+    const uint8_t*  expected;
+    uint32_t        mismatches;
+    uint32_t        bytes;
+} frame_check_t;
+
+static void frame_sink(const uint8_t* data, uint16_t length, uint32_t offset, uint32_t total, void* user) {
+    frame_check_t* check = (frame_check_t*) user;
+    for (uint16_t i = 0; i < length; i++)
+        if (data[i] != check->expected[offset + i]) check->mismatches++;
+    check->bytes += length;
+}
+
+static void on_message(const char* topic, const char* payload, uint16_t length, void* user) {
+    delivered_bytes += length;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t latency_ms = (argc > 1) ? atoi(argv[1]) : 30;
+    uint32_t publish_count = (argc > 2) ? atoi(argv[2]) : 10;
+    if (argc > 3 && strcmp(argv[3], "-") != 0 && (trace_file = fopen(argv[3], "w")) == NULL) {
+        printf("$> %s couldn't opened.\n", argv[3]);
+        return 1;
+    }
+    if (argc > 4) {
+        if ((capture_file = fopen(argv[4], "wb")) == NULL) {
+            printf("$> %s couldn't opened.\n", argv[4]);
+            return 1;
+        }
+        telit_capture_start();
+    }
+
+    telit_sim_init(&sim);
+    sim.latency_ms = latency_ms;
+    telit_sim_attach(&sim);
+
+    // Initilization of the TELIT mode.
+    uint64_t started_us = telit_now_us();
+    telit_init_3g();
+
+    // Enable and set the MQTT.
+    if (process_mqtt_enable(false, "mqtt3.thingspeak.com", "1883")) {
+        printf("$> MQTT couldn't enabled.\n");
+        return 1;
+    }
+    mqtt_set_message_handler(on_message, NULL);
+    process_mqtt_login("NzsNHSIHKy40Jx8AKSIfHg8", "NzsNHSIHKy40Jx8AKSIfHg8", "WIr4lWLSISAqwDL8fOuRp0Nk");
+    mqtt_subscribe_topic("channels/1708249/subscribe/fields/field1");
+    uint64_t ready_us = telit_now_us();
+    drain_trace();
+
+    // Publish to the topic.
+    uint32_t published = 0;
+    for (uint32_t i = 0; i < publish_count; i++) {
+        if (!mqtt_publish("channels/1708249/publish", "field1=500&status=MQTTPUBLISH"))
+            published++;
+    }
+    uint64_t finished_us = telit_now_us();
+    drain_trace();
+
+    // The loopback of the publishes is announced with #MQRING.
+    uint32_t polls = sim.commands;
+    uint8_t delivered = mqtt_process_messages();
+    uint32_t delivered_total = delivered_bytes;
+    uint64_t delivered_us = telit_now_us();
+    polls = sim.commands - polls - delivered;
+    drain_trace();
+
+    // Queue some queries, and keep doing application work while they run.
+    uint32_t completed = 0;
+    uint32_t app_ticks = 0;
+    for (uint32_t i = 0; i < TELIT_COMMAND_QUEUE_SIZE; i++)
+        telit_submit("+CSQ", TELIT_MSG_WAIT_MS, on_command, &completed);
+    while (!telit_is_idle()) {
+        telit_poll();
+        telit_sleep_ms(1);
+        app_ticks++;
+    }
+    uint64_t async_us = telit_now_us();
+    drain_trace();
+
+    // Sample field1..field8 every 100 ms, and publish them once per second.
+    telit_batch_t telemetry;
+    telit_batch_init(&telemetry, "channels/1708249/publish", 1000, 128);
+    uint32_t publishes = sim.publishes;
+    uint32_t samples = 0;
+    for (uint32_t tick = 0; tick < 100; tick++) {
+        for (uint8_t field = 1; field <= 8; field++) {
+            char key[8];
+            snprintf(key, sizeof(key), "field%u", field);
+            telit_batch_set_int(&telemetry, key, tick * field);
+            samples++;
+        }
+        telit_batch_poll(&telemetry);
+        telit_sleep_ms(100);
+    }
+    telit_batch_flush(&telemetry);
+    uint64_t batched_us = telit_now_us();
+    publishes = sim.publishes - publishes;
+    float fill_ratio = telit_batch_fill_ratio(&telemetry);
+    drain_trace();
+
+    // The session drops for a minute, the windows are kept in the outbox.
+    telit_store_file_t outbox_file;
+    telit_store_t outbox;
+    if (telit_store_file_open(&outbox_file, "telit_outbox.bin", 4)
+        || telit_store_mount(&outbox, &outbox_file.backend, TELIT_STORE_DROP_OLDEST)) {
+        printf("$> The outbox couldn't opened.\n");
+        return 1;
+    }
+    telit_batch_set_store(&telemetry, &outbox);
+    uint32_t previous = outbox.count;
+
+    sim.mqtt[0].connected = false;
+    for (uint32_t tick = 0; tick < 60; tick++) {
+        telit_batch_set_int(&telemetry, "field1", tick);
+        telit_batch_poll(&telemetry);
+        telit_sleep_ms(1000);
+    }
+    telit_batch_flush(&telemetry);
+    drain_trace();
+
+    // A reboot finds the queue in the file again.
+    telit_store_mount(&outbox, &outbox_file.backend, TELIT_STORE_DROP_OLDEST);
+    uint32_t queued = outbox.count;
+
+    sim.mqtt[0].connected = true;
+    uint64_t reconnected_us = telit_now_us();
+    uint32_t forwarded = telit_store_forward(&outbox);
+    uint64_t forwarded_us = telit_now_us();
+    telit_store_file_close(&outbox_file);
+    drain_trace();
+
+    // 20 messages pile up while nobody listens, e.g. before a reconnect.
+    mqtt_process_messages();
+    uint64_t drained_us = telit_now_us();
+    sim.ring = false;
+    for (uint32_t i = 0; i < 20; i++) {
+        char payload[32];
+        int length = snprintf(payload, sizeof(payload), "field1=%u&status=BACKLOG", i);
+        telit_sim_queue_message(&sim, 1, "channels/1708249/subscribe/fields/field1", (const uint8_t*) payload, length);
+    }
+    sim.ring = true;
+    uint32_t backlog_bytes = 0;
+    uint8_t backlog = mqtt_read_all(on_message_view, &backlog_bytes);
+    uint64_t backlog_us = telit_now_us();
+    drain_trace();
+
+    // A 3 KB config blob goes out and comes back, far more than any buffer.
+    mqtt_set_message_handler(NULL, NULL);
+    uint32_t blob_length = 3000;
+    uint64_t tx_overruns = sim.tx_overruns;
+    bool is_blob_sent = !mqtt_publish_stream("channels/1708249/publish", blob_length, blob_source, NULL)
+        && sim.tx_overruns == tx_overruns;
+    blob_check_t blob = { 0 };
+    // It is the only message waiting, so it takes the first slot.
+    bool is_blob_read = !mqtt_read_stream(1, blob_sink, &blob);
+    uint64_t blob_us = telit_now_us();
+    drain_trace();
+
+    // The same 8 fields as a query string, and as a frame of 16-bit values.
+    char query[TELIT_BATCH_PAYLOAD_SIZE];
+    uint8_t frame[1 + 8 * 2];
+    int query_length = 0;
+    frame[0] = 1;   // Version of the frame.
+    for (uint8_t field = 1; field <= 8; field++) {
+        int16_t value = 1000 + field * 1111;
+        query_length += snprintf(query + query_length, sizeof(query) - query_length, "%sfield%u=%d",
+                                 field > 1 ? "&" : "", field, value);
+        frame[1 + (field - 1) * 2] = value & 0xFF;
+        frame[2 + (field - 1) * 2] = value >> 8;
+    }
+    frame[3] = '\r';   // A CR and a comma in the frame, which a query string can't carry.
+    frame[4] = ',';
+
+    uint64_t tx_bytes = sim.tx_bytes;
+    bool is_query_sent = !mqtt_publish("channels/1708249/publish", query);
+    uint32_t query_air = sim.tx_bytes - tx_bytes;
+    tx_bytes = sim.tx_bytes;
+    bool is_frame_sent = !mqtt_publish_binary("channels/1708249/publish", frame, sizeof(frame));
+    uint32_t frame_air = sim.tx_bytes - tx_bytes;
+
+    // The frame comes back into the second slot, byte by byte the same.
+    frame_check_t frame_check = { .expected = frame };
+    bool is_frame_read = !mqtt_read_stream(2, frame_sink, &frame_check);
+    drain_trace();
+
+    double init_s = (ready_us - started_us) / 1e6;
+    double publish_s = (finished_us - ready_us) / 1e6;
+
+    printf("$> Modem latency: %u ms\n", latency_ms);
+    printf("$> Init to subscribed: %.3f s\n", init_s);
+    printf("$> Published: %u/%u in %.3f s (%.3f msg/s)\n", published, publish_count, publish_s,
+           publish_s > 0 ? published / publish_s : 0.0);
+    printf("$> Delivered: %u messages (%u bytes) in %.3f s, %u polls\n", delivered, delivered_total,
+           (delivered_us - finished_us) / 1e6, polls);
+    printf("$> Async: %u/%u commands in %.3f s, %u ms of application work meanwhile\n", completed,
+           TELIT_COMMAND_QUEUE_SIZE, (async_us - delivered_us) / 1e6, app_ticks);
+    printf("$> Batched: %u samples in %u publishes over %.3f s, fill ratio %.2f\n", samples, publishes,
+           (batched_us - async_us) / 1e6, fill_ratio);
+    printf("$> Outbox: %u queued offline (%u from before), %u forwarded in %.3f s, %u erases\n", queued,
+           previous, forwarded, (forwarded_us - reconnected_us) / 1e6, outbox_file.erases);
+    printf("$> Backlog: %u messages (%u bytes) in %.3f s, %u without a copy\n", backlog, backlog_bytes,
+           (backlog_us - drained_us) / 1e6, in_place_views);
+    printf("$> Blob: %u bytes %s, %u bytes %s in %u pieces, %u mismatches in %.3f s\n", blob_length,
+           is_blob_sent ? "sent" : "not sent", blob.bytes, is_blob_read ? "read" : "cut", blob.pieces,
+           blob.mismatches, (blob_us - backlog_us) / 1e6);
+    printf("$> Telemetry on air: query %u bytes (%s), binary frame %u bytes (%s), read back %s with %u mismatches\n",
+           query_air, is_query_sent ? "sent" : "not sent", frame_air, is_frame_sent ? "sent" : "not sent",
+           (is_frame_read && frame_check.bytes == sizeof(frame)) ? "whole" : "cut", frame_check.mismatches);
+    telit_stats_print(telit_command_stats());
+    printf("$> Commands: %u, reboots: %u, RX overflows: %u, TX overruns: %llu\n", sim.commands, sim.reboots,
+           telit_rx_ring()->overflows, (unsigned long long) sim.tx_overruns);
+    printf("$> Trace: %u events, %u lost\n", traced_events, telit_trace.lost);
+    if (capture_file != NULL) printf("$> Capture: %u bytes lost\n", telit_capture_lost());
+
+    // Any shortfall, mismatch, cut read or loss fails the run, e.g. for the CI.
+    bool is_failed = published != publish_count || delivered != published || completed != TELIT_COMMAND_QUEUE_SIZE
+        || forwarded != queued || backlog != 20 || !is_blob_sent || !is_blob_read || blob.bytes != blob_length
+        || blob.mismatches != 0 || !is_query_sent || !is_frame_sent || !is_frame_read
+        || frame_check.bytes != sizeof(frame) || frame_check.mismatches != 0 || telit_rx_ring()->overflows != 0
+        || sim.tx_overruns != 0 || telit_trace.lost != 0 || (capture_file != NULL && telit_capture_lost() != 0);
+
+    if (trace_file != NULL) fclose(trace_file);
+    if (capture_file != NULL) fclose(capture_file);
+
+    return is_failed ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telit.h"
+#include "telit_ring.h"
+
+/*
+* Feeds a UART capture back into the SDK: the bytes of the modem arrive at
+* the time they arrived in the field, and the commands of the application
+* are sent again at the time they were sent. Only the modem and the clock
+* are replayed; the parser, the URCs and the commands run as they do on
+* the board, so two versions of the SDK can be compared on the same session.
+*
+* The capture is a log of telit_capture_drain(), or a console log of the
+* firmware with its "#C" lines.
+*
+* Usage: telit_replay <capture_file> [speed] [results_file]
+*
+* A speed of 0, the default, runs as fast as the CPU can, 1 in real time,
+* N at N times the speed. The results are JSON lines as of telit_bench.
+*/
+
+// A write of the application: a command line, or raw bytes such as a payload after "> ".
+typedef struct replay_write {
+    uint64_t    time_us;
+    uint32_t    offset;         // In tx_bytes.
+    uint32_t    length;
+    bool        is_command;
+} replay_write_t;
+
+static uint8_t* log_data;
+static size_t log_length;
+
+static telit_capture_record_t* rx_records;
+static uint32_t rx_count = 0, rx_next = 0, rx_delivered = 0;
+static uint8_t* tx_bytes;
+static uint32_t tx_length = 0, tx_checked = 0, tx_mismatches = 0;
+static replay_write_t* writes;
+static uint32_t write_count = 0;
+static uint32_t lost_bytes = 0;
+
+// The clock of the replay.
+static double speed = 0;
+static uint64_t virtual_us = 0;
+static double started_ns;
+
+static FILE* results_file = NULL;
+
+static double now_ns(clockid_t clock) {
+    struct timespec time;
+    clock_gettime(clock, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static void report(const char* bench, double value, const char* unit) {
+    char line[160];
+    snprintf(line, sizeof(line), "{\"bench\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n", bench, value, unit);
+
+    fputs(line, stdout);
+    if (results_file != NULL) fputs(line, results_file);
+}
+
+static uint64_t replay_now_us() {
+    if (speed == 0) return virtual_us;
+    return (uint64_t) ((now_ns(CLOCK_MONOTONIC) - started_ns) / 1e3 * speed);
+}
+
+// The bytes of the modem which are due are pushed, as the UART ISR does, while the ring has room.
+static void replay_deliver() {
+    telit_ring_t* ring = telit_rx_ring();
+    uint64_t now_us = replay_now_us();
+
+    while (rx_next < rx_count && rx_records[rx_next].time_us <= now_us) {
+        const telit_capture_record_t* record = &rx_records[rx_next];
+        if (telit_ring_count(ring) + record->length > ring->mask + 1) break;
+
+        for (uint16_t i = 0; i < record->length; i++)
+            telit_ring_push(ring, record->data[i]);
+        rx_delivered += record->length;
+        rx_next++;
+    }
+}
+
+static void replay_wait_until(uint64_t time_us) {
+    if (speed == 0) {
+        if (time_us > virtual_us) virtual_us = time_us;
+    }
+    else {
+        uint64_t now_us = replay_now_us();
+        if (time_us > now_us) {
+            double wait_ns = (time_us - now_us) * 1e3 / speed;
+            struct timespec time = { .tv_sec = wait_ns / 1e9, .tv_nsec = (long) wait_ns % 1000000000L };
+            nanosleep(&time, NULL);
+        }
+    }
+    replay_deliver();
+}
+
+// The bytes the SDK writes are checked against the capture.
+static void replay_port_write(void* user, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++, tx_checked++)
+        if (tx_checked >= tx_length || tx_bytes[tx_checked] != data[i]) tx_mismatches++;
+}
+
+static uint64_t replay_port_now_us(void* user) {
+    return replay_now_us();
+}
+
+static void replay_port_sleep_ms(void* user, uint32_t ms) {
+    replay_wait_until(replay_now_us() + (uint64_t) ms * 1000);
+}
+
+// It returns early when the next bytes of the modem are due.
+static void replay_port_wait_ms(void* user, uint32_t timeout_ms) {
+    uint64_t until_us = replay_now_us() + (uint64_t) timeout_ms * 1000;
+    if (rx_next < rx_count && rx_records[rx_next].time_us < until_us)
+        until_us = rx_records[rx_next].time_us;
+    replay_wait_until(until_us);
+}
+
+static void replay_port_reboot(void* user) {
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief Takes the log out of the "#C <hex>" lines of a console log, in
+ * place; the rest of the console is skipped.
+ */
+static size_t unpack_console(uint8_t* data, size_t length) {
+    size_t out = 0;
+
+    for (size_t i = 0; i + 3 <= length; i++) {
+        // Only a "#C " at the start of a line.
+        if ((i > 0 && data[i - 1] != '\n') || memcmp(data + i, "#C ", 3) != 0) continue;
+
+        for (i += 3; i + 1 < length; i += 2) {
+            int high = hex_value(data[i]), low = hex_value(data[i + 1]);
+            if (high < 0 || low < 0) break;
+            data[out++] = (uint8_t) (high << 4 | low);
+        }
+    }
+
+    return out;
+}
+
+static bool load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return true;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    log_data = malloc(size > 0 ? size : 1);
+    log_length = fread(log_data, 1, size, file);
+    fclose(file);
+
+    if (log_length < 4 || memcmp(log_data, TELIT_CAPTURE_MAGIC, 4) != 0)
+        log_length = unpack_console(log_data, log_length);
+
+    telit_capture_reader_t reader;
+    if (telit_capture_reader_init(&reader, log_data, log_length)) return true;
+
+    // Counted first, so the arrays are allocated once.
+    telit_capture_record_t record;
+    uint32_t records = 0;
+    while (!telit_capture_read(&reader, &record)) records++;
+
+    rx_records = malloc((records + 1) * sizeof(*rx_records));
+    writes = malloc((records + 1) * sizeof(*writes));
+    tx_bytes = malloc(log_length);
+
+    // The writes are put together: a command line ends with CR+LF, raw bytes end with their record.
+    telit_capture_reader_init(&reader, log_data, log_length);
+    replay_write_t* write = NULL;
+
+    while (!telit_capture_read(&reader, &record)) {
+        if (record.length == 0) {
+            lost_bytes += record.lost;
+            continue;
+        }
+        if (record.is_from_modem) {
+            rx_records[rx_count++] = record;
+            continue;
+        }
+
+        for (uint16_t i = 0; i < record.length; i++) {
+            if (write == NULL) {
+                write = &writes[write_count++];
+                write->time_us = record.time_us;
+                write->offset = tx_length;
+                write->length = 0;
+                write->is_command = record.data[i] == 'A';
+            }
+
+            tx_bytes[tx_length++] = record.data[i];
+            write->length++;
+
+            if (write->is_command && write->length >= 2 && tx_bytes[tx_length - 2] == '\r' && tx_bytes[tx_length - 1] == '\n')
+                write = NULL;
+        }
+        if (write != NULL && !write->is_command) write = NULL;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Sends the write again through the SDK. A command goes through
+ * the same path as on the board; raw bytes are only accounted for, the
+ * replayed modem doesn't need them.
+ */
+static bool replay_write(const replay_write_t* write) {
+    if (!write->is_command || write->length < 4) {
+        tx_checked += write->length;
+        return false;
+    }
+
+    // "AT" and CR+LF are put back by the command builder.
+    static char line[4096];
+    static char body[4096];
+    if (write->length - 4 >= sizeof(body)) {
+        tx_checked += write->length;
+        return true;
+    }
+    memcpy(body, tx_bytes + write->offset + 2, write->length - 4);
+    body[write->length - 4] = '\0';
+
+    telit_cmd_t cmd;
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_RAW);
+    telit_cmd_append(&cmd, body);
+    telit_cmd_end(&cmd);
+
+    // The SDK writes it, and the port checks it, from where it is in the capture.
+    tx_checked = write->offset;
+    return send_command_to_telit(&cmd);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("$> Usage: telit_replay <capture_file> [speed] [results_file]\n");
+        return 1;
+    }
+    speed = (argc > 2) ? atof(argv[2]) : 0;
+    if (argc > 3 && (results_file = fopen(argv[3], "w")) == NULL) {
+        printf("$> %s couldn't opened.\n", argv[3]);
+        return 1;
+    }
+    if (load(argv[1])) {
+        printf("$> %s is not a capture.\n", argv[1]);
+        return 1;
+    }
+
+    telit_port_t port = {
+        .write = replay_port_write,
+        .now_us = replay_port_now_us,
+        .sleep_ms = replay_port_sleep_ms,
+        .wait_ms = replay_port_wait_ms,
+        .reboot = replay_port_reboot,
+    };
+    telit_set_port(&port);
+
+    uint64_t session_us = 0;
+    if (rx_count > 0) session_us = rx_records[rx_count - 1].time_us;
+    if (write_count > 0 && writes[write_count - 1].time_us > session_us) session_us = writes[write_count - 1].time_us;
+
+    uint32_t write_next = 0, commands = 0, skipped = 0;
+    started_ns = now_ns(CLOCK_MONOTONIC);
+    double cpu_started_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    // The writes and the bytes of the modem go in the order of their time.
+    while (write_next < write_count || rx_next < rx_count) {
+        uint64_t next_us = UINT64_MAX;
+        if (write_next < write_count) next_us = writes[write_next].time_us;
+        if (rx_next < rx_count && rx_records[rx_next].time_us < next_us) next_us = rx_records[rx_next].time_us;
+
+        replay_wait_until(next_us);
+        telit_process_rx();
+
+        while (write_next < write_count && writes[write_next].time_us <= replay_now_us()) {
+            const replay_write_t* write = &writes[write_next++];
+            if (replay_write(write)) skipped++;
+            else if (write->is_command) commands++;
+        }
+    }
+    telit_process_rx();
+
+    double wall_s = (now_ns(CLOCK_MONOTONIC) - started_ns) / 1e9;
+    double cpu_s = (now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_started_ns) / 1e9;
+
+    // The latency of the commands is the one of the field, plus what the SDK adds.
+    const telit_stats_t* stats = telit_command_stats();
+    uint32_t results = 0, errors = 0, timeouts = 0;
+    uint64_t total_ms = 0;
+    for (uint8_t i = 0; i < stats->command_count; i++) {
+        const telit_command_stats_t* command = &stats->commands[i];
+        results += command->count;
+        errors += command->errors + command->cme_errors;
+        timeouts += command->timeouts;
+        total_ms += command->total_ms;
+    }
+
+    report("replay_session", session_us / 1e6, "s");
+    report("replay_wall", wall_s, "s");
+    report("replay_speedup", wall_s > 0 ? session_us / 1e6 / wall_s : 0, "x");
+    report("replay_rx_throughput", cpu_s > 0 ? rx_delivered / cpu_s / 1e6 : 0, "MB/s");
+    report("replay_commands", commands, "commands");
+    report("replay_commands_skipped", skipped, "commands");
+    report("replay_results", results, "commands");
+    report("replay_errors", errors, "commands");
+    report("replay_timeouts", timeouts, "commands");
+    report("replay_latency_avg", results > 0 ? (double) total_ms / results : 0, "ms");
+    report("replay_tx_mismatches", tx_mismatches, "bytes");
+    report("replay_rx_overflows", telit_rx_ring()->overflows, "bytes");
+    report("replay_capture_lost", lost_bytes, "bytes");
+
+    for (uint8_t i = 0; i < stats->command_count; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "replay_latency_p90.%s", stats->commands[i].tag);
+        report(name, telit_stats_percentile_ms(&stats->commands[i], 90), "ms");
+    }
+
+    if (results_file != NULL) fclose(results_file);
+    return (tx_mismatches > 0 || timeouts > 0) ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telit_trace.h"
+
+/*
+* Turns the trace lines of telit_trace_drain(), e.g. from the USB console
+* of the firmware, back into text. Other lines are passed through as they
+* are, so the console can be decoded as a whole.
+*
+* Usage: telit_trace_decode [file]   (stdin without a file)
+*/
+
+static const char* result_names[] = { "OK", "ERROR", "+CME ERROR", "+CMS ERROR", "TIMEOUT" };
+static const char* publish_kinds[] = { "inline", "stream", "binary" };
+static const char* read_deliveries[] = { "view", "copy", "sink" };
+static const char* attach_events[] = { "entered", "retry", "fallback" };
+
+#define NAME_OF(names, index) (((index) < sizeof(names) / sizeof(names[0])) ? names[index] : "?")
+
+// The tag packed by TELIT_TRACE_TAG().
+static void unpack_tag(uint32_t low, uint32_t high, char tag[9]) {
+    for (uint8_t i = 0; i < 4; i++) {
+        tag[i] = (char) (low >> (8 * i));
+        tag[4 + i] = (char) (high >> (8 * i));
+    }
+    tag[8] = '\0';
+}
+
+static void print_arguments(const telit_trace_record_t* record) {
+    char tag[9];
+
+    switch (record->id) {
+        case TELIT_TRACE_LOST:
+            printf("%u events lost", record->arg1);
+            break;
+        case TELIT_TRACE_CMD_WRITE:
+            unpack_tag(record->arg1, record->arg2, tag);
+            printf("AT%s, %u bytes", tag, record->arg0);
+            break;
+        case TELIT_TRACE_CMD_FINAL:
+            unpack_tag(record->arg1, record->arg2, tag);
+            printf("AT%s, %s", tag, NAME_OF(result_names, record->arg0));
+            break;
+        case TELIT_TRACE_CMD_TIMEOUT:
+            unpack_tag(record->arg1, record->arg2, tag);
+            printf("AT%s", tag);
+            break;
+        case TELIT_TRACE_URC:
+            unpack_tag(record->arg1, record->arg2, tag);
+            printf("%s..., %u bytes", tag, record->arg0);
+            break;
+        case TELIT_TRACE_BAUDRATE:
+            printf("%u baud %s", record->arg1, record->arg0 ? "passed" : "failed");
+            break;
+        case TELIT_TRACE_RX_OVERFLOW:
+            printf("%u bytes dropped so far", record->arg1);
+            break;
+        case TELIT_TRACE_MQTT_PUBLISH:
+            printf("%s, %u bytes, %s", NAME_OF(publish_kinds, record->arg0), record->arg1, NAME_OF(result_names, record->arg2));
+            break;
+        case TELIT_TRACE_MQTT_RING:
+            printf("id %u, %u waiting, %u lost", record->arg0, record->arg1, record->arg2);
+            break;
+        case TELIT_TRACE_MQTT_READ:
+            printf("id %u, %u bytes, %s", record->arg0, record->arg1, NAME_OF(read_deliveries, record->arg2));
+            break;
+        case TELIT_TRACE_MQTT_READ_ALL:
+            printf("%u of %u read", record->arg1, record->arg2);
+            break;
+        case TELIT_TRACE_ATTACH_EVENT:
+            printf("state %u %s, backoff %u ms", record->arg0, NAME_OF(attach_events, record->arg1), record->arg2);
+            break;
+        case TELIT_TRACE_ATTACH_READY:
+            printf("%s after %u probes, %u ms", record->arg0 ? "answered" : "silent", record->arg1, record->arg2);
+            break;
+        case TELIT_TRACE_STORE_PUSH:
+            printf("sequence %u, %u waiting", record->arg1, record->arg2);
+            break;
+        case TELIT_TRACE_STORE_POP:
+            printf("%u waiting", record->arg2);
+            break;
+        case TELIT_TRACE_STORE_DROP:
+            printf("%u dropped so far, %u waiting", record->arg1, record->arg2);
+            break;
+        case TELIT_TRACE_STORE_FORWARD:
+            printf("%u forwarded, %u waiting", record->arg1, record->arg2);
+            break;
+        default:
+            printf("%04x %08x %08x", record->arg0, record->arg1, record->arg2);
+            break;
+    }
+}
+
+int main(int argc, char** argv) {
+    FILE* input = stdin;
+    if (argc > 1 && (input = fopen(argv[1], "r")) == NULL) {
+        printf("$> %s couldn't opened.\n", argv[1]);
+        return 1;
+    }
+
+    char line[256];
+    telit_trace_record_t record;
+    uint64_t time_us = 0;
+    uint32_t last_us = 0, events = 0, lost = 0;
+    bool has_time = false;
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        if (telit_trace_parse(line, &record)) {
+            fputs(line, stdout);
+            continue;
+        }
+
+        // The clock is kept in 32 bits, it wraps every 71 minutes.
+        uint32_t delta_us = has_time ? record.time_us - last_us : 0;
+        time_us += delta_us;
+        last_us = record.time_us;
+        has_time = true;
+
+        const char* name = telit_trace_name(record.id);
+        printf("%12.6f +%9.6f  %-14s ", time_us / 1e6, delta_us / 1e6, (name != NULL) ? name : "?");
+        print_arguments(&record);
+        printf("\n");
+
+        if (record.id == TELIT_TRACE_LOST) lost += record.arg1;
+        else events++;
+    }
+
+    printf("$> %u events decoded, %u lost.\n", events, lost);
+    if (input != stdin) fclose(input);
+    return 0;
+}
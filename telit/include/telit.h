@@ -0,0 +1,203 @@
+#ifndef TELIT_H
+#define TELIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_attach.h"
+#include "telit_batch.h"
+#include "telit_capture.h"
+#include "telit_cmd.h"
+#include "telit_config.h"
+#include "telit_engine.h"
+#include "telit_parser.h"
+#include "telit_port.h"
+#include "telit_query.h"
+#include "telit_stats.h"
+#include "telit_store.h"
+#include "telit_trace.h"
+#include "telit_urc.h"
+
+// It gets the final result code of a submitted command, and its information response if there is.
+typedef void (*telit_command_callback_t)(telit_result_t result, const telit_event_t* info, void* user);
+
+// A command waiting in the queue of telit_submit().
+typedef struct telit_command {
+    char                        command[TELIT_COMMAND_SIZE];
+    uint32_t                    timeout_ms;
+    telit_command_callback_t    on_complete;
+    void*                       user;
+} telit_command_t;
+
+// TELIT
+bool telit_submit(const char[], uint32_t, telit_command_callback_t, void*);
+void telit_poll();
+bool telit_is_idle();
+telit_result_t telit_wait_final(uint32_t);
+const telit_event_t* telit_last_info();
+const telit_stats_t* telit_command_stats();
+bool telit_on_urc(const char[], telit_urc_handler_t, void*);
+bool telit_remove_urc(const char[], telit_urc_handler_t);
+void send_message_to_telit(char[]);
+bool send_command_to_telit(const telit_cmd_t*);
+bool check_signal_quality();
+void process_signal_quailty();
+uint8_t check_carrier_registration();
+void process_carrier_registration();
+uint8_t check_gprs_registration();
+void process_gprs_registration();
+bool enable_registration_reports();
+bool check_gprs_attach();
+void process_gprs_attach();
+bool define_apn();
+bool activate_pdp();
+bool telit_wait_ready(uint32_t);
+bool telit_set_flow_control(bool);
+uint32_t telit_find_baudrate(const uint32_t[], uint8_t);
+uint32_t telit_negotiate_baudrate(const uint32_t[], uint8_t, uint32_t);
+void telit_init_3g();
+
+// MQTT
+// It gets a message announced by #MQRING; the payload is terminated.
+typedef void (*mqtt_message_handler_t)(const char* topic, const char* payload, uint16_t length, void* user);
+
+/**
+ * @brief A message read by mqtt_read_all(). The topic and the payload are
+ * not terminated; they point into the RX storage and are valid only while
+ * the handler runs.
+ */
+typedef struct mqtt_message_view {
+    uint8_t         id;
+    const char*     topic;
+    uint16_t        topic_length;
+    const uint8_t*  payload;
+    uint16_t        length;
+} mqtt_message_view_t;
+
+typedef void (*mqtt_view_handler_t)(const mqtt_message_view_t* message, void* user);
+
+// What the MQTT of the modem is to be set to; mqtt_configure() writes only what differs.
+typedef struct mqtt_config {
+    const char*     broker;
+    uint16_t        port;
+    bool            last_will;
+    uint16_t        keepalive_s;
+    bool            clean_session;
+} mqtt_config_t;
+
+// How far the MQTT session of the modem is set up, e.g. after a reboot of the board.
+typedef enum mqtt_session {
+    MQTT_SESSION_NONE,              // It has to be enabled and configured.
+    MQTT_SESSION_CONFIGURED,        // It is configured for the broker, the login is left.
+    MQTT_SESSION_CONNECTED,         // It is logged in to the broker.
+} mqtt_session_t;
+
+/**
+ * @brief An MQTT client of the modem, on one of its instances, with a
+ * broker and a session of its own. The MQTT functions talk to the client
+ * selected with mqtt_select(); the #MQRING of every client is kept for it.
+ */
+typedef struct mqtt_client {
+    uint8_t                 ring_queue[TELIT_MQTT_RING_QUEUE_SIZE]; // Messages announced by #MQRING, they are read by mqtt_process_messages().
+    uint8_t                 ring_queue_head;
+    uint8_t                 ring_queue_count;
+    uint32_t                lost_rings;                             // Announcements which didn't fit in the queue.
+    uint32_t                empty_slots;                            // Bit n-1 is set while message id n is known to be read, see mqtt_read_all().
+    mqtt_message_handler_t  message_handler;
+    void*                   message_handler_user;
+} mqtt_client_t;
+
+// It takes a piece of a streamed payload, which starts at offset of total bytes.
+typedef void (*telit_data_sink_t)(const uint8_t* data, uint16_t length, uint32_t offset, uint32_t total, void* user);
+// It writes the payload from offset into the buffer, and returns the bytes written.
+typedef uint16_t (*telit_data_source_t)(uint8_t* buffer, uint16_t size, uint32_t offset, void* user);
+
+bool mqtt_configure(const mqtt_config_t*);
+bool mqtt_enable_and_configure(bool, char[], char[]);
+uint8_t mqtt_login(char[], char[], char[]);
+bool mqtt_logout();
+uint8_t mqtt_connection_status();
+mqtt_session_t mqtt_session_state(bool, char[], char[]);
+bool mqtt_subscribe_topic(char[]);
+bool mqtt_publish(char[], char[]);
+bool mqtt_publish_stream(char[], uint32_t, telit_data_source_t, void*);
+bool mqtt_publish_binary(char[], const uint8_t[], uint32_t);
+bool mqtt_publish_binary_stream(char[], uint32_t, telit_data_source_t, void*);
+char* mqtt_read(uint8_t);
+char* mqtt_read_in_queue();
+bool mqtt_new_message_count(uint16_t*);
+uint8_t mqtt_read_all(mqtt_view_handler_t, void*);
+bool mqtt_read_stream(uint8_t, telit_data_sink_t, void*);
+void mqtt_set_message_handler(mqtt_message_handler_t, void*);
+uint8_t mqtt_process_messages();
+uint8_t mqtt_process_messages_max(uint8_t);
+uint8_t mqtt_announced_messages();
+uint8_t mqtt_select(uint8_t);
+uint8_t mqtt_selected();
+bool process_mqtt_login(char[], char[], char[]);
+bool process_mqtt_enable(bool, char[], char[]);
+
+// MODEMS
+// It takes the answers of a line of more than one command, which the last information response can't keep all of.
+typedef bool (*telit_info_collector_t)(const telit_event_t* event, void* user);
+
+/**
+ * @brief Everything the SDK keeps of one modem: its port, the ring its ISR
+ * fills, the parser, the queues and the handlers. The functions above talk
+ * to the modem selected with telit_select(); the one telit_set_port() binds
+ * at the start is selected until another is.
+ */
+typedef struct telit_modem {
+    telit_port_t            port;                                   // The transport and clock of the modem.
+    uint8_t                 rx_ring_storage[TELIT_RX_RING_SIZE];    // The data coming from RX until the main loop takes it.
+    telit_ring_t            rx_ring;                                // The ISR pushes into it, the main loop pops from it.
+    telit_parser_t          parser;                                 // It turns the bytes coming from RX into events.
+    telit_event_t           last_info;                              // The last information response of the command.
+    char                    last_info_line[TELIT_PARSER_LINE_SIZE];
+    bool                    has_last_info;                          // It is true when the command has an information response.
+    char                    message_buffer[TELIT_BUFFER_SIZE];      // The payload of the last message read.
+    uint16_t                message_buffer_index;
+    volatile bool           is_message_finished;                    // It is true when the message is finished with OK or ERROR.
+    volatile bool           is_prompt_received;                     // It is true when the modem waits for the data of the message.
+    telit_result_t          message_result;                         // The final result code of the message.
+    char                    last_echo[TELIT_COMMAND_SIZE];          // The echo of the command, for the test of a speed.
+    bool                    is_echo_off;                            // The last OK came without an echo, as after ATE0.
+    char                    tx_line[TELIT_COMMAND_LINE_SIZE];       // The line of the command being sent.
+    uint16_t                ip_address[4];                          // The IP address given by the PDP context.
+    telit_urc_table_t       urc_table;                              // The handlers of the unsolicited result codes.
+    telit_stats_t           command_stats;                          // The latency and the results of every command type.
+    telit_attach_t          network_attach;                         // The network bring-up of telit_init_3g().
+
+    // Commands submitted without waiting, they are sent one by one by telit_poll().
+    telit_command_t         command_queue[TELIT_COMMAND_QUEUE_SIZE];
+    uint8_t                 command_head;
+    uint8_t                 command_count;
+    bool                    is_command_sent;                        // The first command of the queue is on the way.
+    uint64_t                command_deadline_us;
+
+    // The MQTT clients, on the instances of the modem from 1 on.
+    mqtt_client_t           mqtt_clients[TELIT_MQTT_CLIENT_COUNT];
+    uint8_t                 mqtt_client;                            // The index of the client selected, see mqtt_select().
+    uint32_t                traced_overflows;                       // The RX overflows the trace has told about.
+
+    // The burst of mqtt_read_all(), the payloads are given to the handler as they arrive.
+    mqtt_view_handler_t     read_handler;
+    void*                   read_handler_user;
+    uint8_t                 read_message_id;                        // The id of the message being read.
+    uint32_t                read_remaining;                         // The bytes of the payload still to come.
+    uint8_t                 read_delivered;                         // The messages given to the handler so far.
+    uint32_t                read_total;                             // The length of the payload being read.
+    telit_data_sink_t       data_sink;                              // It takes the payload of mqtt_read_stream() piece by piece.
+    void*                   data_sink_user;
+
+    // The answers of a line of more than one command.
+    telit_info_collector_t  info_collector;
+    void*                   info_collector_user;
+} telit_modem_t;
+
+void telit_modem_init(telit_modem_t*, const telit_port_t*);
+telit_modem_t* telit_select(telit_modem_t*);
+telit_modem_t* telit_selected();
+telit_modem_t* telit_default_modem();
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef TELIT_ATTACH_H
+#define TELIT_ATTACH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+#include "telit_parser.h"
+
+// Steps of the network bring-up, in order.
+typedef enum telit_attach_state {
+    TELIT_ATTACH_IDLE,
+    TELIT_ATTACH_SIGNAL,            // +CSQ
+    TELIT_ATTACH_CARRIER,           // +CREG?
+    TELIT_ATTACH_GPRS,              // +CGREG?
+    TELIT_ATTACH_GPRS_ATTACH,       // +CGATT?
+    TELIT_ATTACH_APN,               // +CGDCONT=
+    TELIT_ATTACH_PDP,               // #SGACT?
+    TELIT_ATTACH_PDP_ACTIVATE,      // #SGACT=1,1
+    TELIT_ATTACH_READY,
+} telit_attach_state_t;
+
+typedef enum telit_attach_event {
+    TELIT_ATTACH_ENTERED,           // A step is started.
+    TELIT_ATTACH_RETRY,             // The step failed, it is tried again after the backoff.
+    TELIT_ATTACH_FALLBACK,          // The step failed too many times, an earlier step is tried.
+} telit_attach_event_t;
+
+// Exponential backoff between the tries: initial_ms * factor^n, at most max_ms, +- jitter_percent.
+typedef struct telit_backoff {
+    uint32_t    initial_ms;
+    uint32_t    max_ms;
+    uint8_t     factor;
+    uint8_t     jitter_percent;
+} telit_backoff_t;
+
+struct telit_attach;
+typedef void (*telit_attach_callback_t)(const struct telit_attach* attach, telit_attach_event_t event, void* user);
+
+typedef struct telit_attach {
+    telit_attach_state_t    state;
+    telit_backoff_t         backoff;
+    uint8_t                 max_attempts;   // Tries of a step before falling back.
+    char                    apn[32];
+
+    uint8_t                 attempt;        // Failed tries of the current step.
+    uint8_t                 failures;       // Failures in a row, they grow the backoff.
+    uint32_t                retries;        // Every failure since the start.
+    uint32_t                delay_ms;       // The last backoff.
+    uint8_t                 rssi;           // <rssi> of +CSQ.
+    char                    ip_address[16];
+
+    bool                    is_busy;        // A command is in the queue.
+    telit_attach_state_t    busy_state;     // The step of the command in the queue.
+    uint64_t                retry_at_us;
+    uint64_t                started_us;
+    uint64_t                ready_us;
+    uint32_t                random;
+
+    telit_attach_callback_t callback;
+    void*                   user;
+} telit_attach_t;
+
+void telit_attach_init(telit_attach_t* attach, const char* apn, telit_attach_callback_t callback, void* user);
+void telit_attach_start(telit_attach_t* attach);
+bool telit_attach_resume(telit_attach_t* attach);
+telit_attach_state_t telit_attach_step(telit_attach_t* attach);
+uint32_t telit_attach_elapsed_ms(const telit_attach_t* attach);
+const char* telit_attach_state_name(telit_attach_state_t state);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TELIT_BATCH_H
+#define TELIT_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+
+// The last value of a key in the window.
+typedef struct telit_batch_field {
+    char    key[TELIT_BATCH_KEY_SIZE];
+    char    value[TELIT_BATCH_VALUE_SIZE];
+} telit_batch_field_t;
+
+struct telit_store;
+
+/**
+ * @brief Collects the updates of a topic, e.g. "field1=500", and publishes
+ * them together as "field1=500&field2=7" once per window, or earlier when
+ * the payload reaches its size threshold. A key updated twice in a window
+ * is sent with its last value.
+ */
+typedef struct telit_batch {
+    char                topic[TELIT_BATCH_TOPIC_SIZE];
+    uint32_t            window_ms;
+    uint16_t            max_payload;    // Size threshold of the payload.
+
+    telit_batch_field_t fields[TELIT_BATCH_MAX_FIELDS];
+    uint8_t             field_count;
+    uint16_t            payload_length; // Length of the payload if it is flushed now.
+    uint64_t            opened_us;      // Time of the first update of the window.
+    struct telit_store* store;          // Keeps the failed publishes, it may be NULL.
+
+    // Statistics.
+    uint32_t            updates;
+    uint32_t            coalesced;      // Updates which replaced a value in the window.
+    uint32_t            flushes;
+    uint32_t            failures;
+    uint64_t            flushed_bytes;  // Payload bytes of the flushes, for the fill ratio.
+} telit_batch_t;
+
+bool telit_batch_init(telit_batch_t* batch, const char* topic, uint32_t window_ms, uint16_t max_payload);
+void telit_batch_set_store(telit_batch_t* batch, struct telit_store* store);
+bool telit_batch_set(telit_batch_t* batch, const char* key, const char* value);
+bool telit_batch_set_int(telit_batch_t* batch, const char* key, int32_t value);
+bool telit_batch_poll(telit_batch_t* batch);
+bool telit_batch_flush(telit_batch_t* batch);
+float telit_batch_fill_ratio(const telit_batch_t* batch);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef TELIT_CAPTURE_H
+#define TELIT_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+
+/*
+* Capture of the UART: every byte written to the modem and received from
+* it, with the time it went through, as a compact binary log. The log of a
+* field session is fed back into the SDK on the host by telit_replay.
+*
+* The bytes are kept in two lock-free rings, one for each direction, so
+* the UART ISR and the main loop never wait for each other. The main loop,
+* or the other core, drains them in the order of time:
+*
+*   "TCAP" <version>                                        once
+*   <delta_us: LEB128> <kind> <bytes>                       per record
+*
+* Bit 7 of kind is the direction (1: from the modem), bits 0-6 are the
+* length of the bytes, 1..127. A length of 0 marks a gap, the LEB128 count
+* of the bytes lost follows instead. delta_us is from the record before.
+*/
+
+#define TELIT_CAPTURE_MAGIC         "TCAP"
+#define TELIT_CAPTURE_VERSION       1
+#define TELIT_CAPTURE_HEADER_SIZE   5
+#define TELIT_CAPTURE_FROM_MODEM    0x80
+#define TELIT_CAPTURE_MAX_CHUNK     127
+
+// The longest record of the log: the delta, the kind, and the bytes.
+#define TELIT_CAPTURE_RECORD_SIZE   (5 + 1 + TELIT_CAPTURE_MAX_CHUNK)
+
+// It takes the log piece by piece, e.g. to write it to a file or the USB.
+typedef void (*telit_capture_writer_t)(const uint8_t* data, uint16_t length, void* user);
+
+// The producers; they cost a check while the capture is off.
+// The time is read by the caller, on the clock of the modem, the ISR does not go through the port.
+#define TELIT_CAPTURE_TX(time_us, data, length) do { if (TELIT_CAPTURE) telit_capture_tx((time_us), (data), (length)); } while (0)
+#define TELIT_CAPTURE_RX(time_us, data, length) do { if (TELIT_CAPTURE) telit_capture_rx((time_us), (data), (length)); } while (0)
+
+void telit_capture_start();
+void telit_capture_stop();
+bool telit_capture_is_on();
+void telit_capture_tx(uint32_t time_us, const uint8_t* data, size_t length);
+void telit_capture_rx(uint32_t time_us, const uint8_t* data, size_t length);
+uint32_t telit_capture_drain(uint32_t max_records, telit_capture_writer_t writer, void* user);
+uint32_t telit_capture_lost();
+
+// A record of the log being read back.
+typedef struct telit_capture_record {
+    uint64_t        time_us;        // From the start of the log.
+    bool            is_from_modem;
+    uint16_t        length;         // 0 for a gap.
+    uint32_t        lost;           // Bytes lost in the gap.
+    const uint8_t*  data;           // It points into the log.
+} telit_capture_record_t;
+
+typedef struct telit_capture_reader {
+    const uint8_t*  data;
+    size_t          length;
+    size_t          offset;
+    uint64_t        time_us;
+} telit_capture_reader_t;
+
+bool telit_capture_reader_init(telit_capture_reader_t* reader, const uint8_t* data, size_t length);
+bool telit_capture_read(telit_capture_reader_t* reader, telit_capture_record_t* record);
+
+#endif
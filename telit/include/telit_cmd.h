@@ -0,0 +1,75 @@
+#ifndef TELIT_CMD_H
+#define TELIT_CMD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+
+// Commands of the table of prefixes.
+typedef enum telit_cmd_id {
+    TELIT_CMD_RAW,              // No prefix, the command is appended.
+    TELIT_CMD_CSQ,
+    TELIT_CMD_IPR,
+    TELIT_CMD_CREG_READ,
+    TELIT_CMD_CGREG_READ,
+    TELIT_CMD_CGATT_READ,
+    TELIT_CMD_CGDCONT,
+    TELIT_CMD_SGACT_READ,
+    TELIT_CMD_SGACT_ACTIVATE,
+    TELIT_CMD_MQEN,
+    TELIT_CMD_MQEN_READ,
+    TELIT_CMD_MQWCFG,
+    TELIT_CMD_MQWCFG_READ,
+    TELIT_CMD_MQCFG,
+    TELIT_CMD_MQCFG_READ,
+    TELIT_CMD_MQCFG2,
+    TELIT_CMD_MQCFG2_READ,
+    TELIT_CMD_MQCONN,
+    TELIT_CMD_MQCONN_READ,
+    TELIT_CMD_MQDISC,
+    TELIT_CMD_MQSUB,
+    TELIT_CMD_MQPUBS,
+    TELIT_CMD_MQPUBSBIN,
+    TELIT_CMD_MQREAD,
+    TELIT_CMD_MQREAD_READ,
+    TELIT_CMD_COUNT,
+} telit_cmd_id_t;
+
+// A prefix with its length, which is known at compile time.
+typedef struct telit_cmd_prefix {
+    const char* text;
+    uint8_t     length;
+} telit_cmd_prefix_t;
+
+extern const telit_cmd_prefix_t telit_cmd_prefixes[TELIT_CMD_COUNT];
+
+/**
+ * @brief A command line being written into a fixed buffer, e.g.
+ * "AT#MQPUBS=1,<topic>,0,0,<payload>\r\n". Nothing is allocated, and
+ * every byte is written once.
+ */
+typedef struct telit_cmd {
+    char*       buffer;
+    uint16_t    size;
+    uint16_t    length;
+    bool        is_overflow;    // Something didn't fit, the line is not to be sent.
+    bool        has_arg;        // An argument is written, the next one takes a comma.
+} telit_cmd_t;
+
+void telit_cmd_begin(telit_cmd_t* cmd, char* buffer, uint16_t size, telit_cmd_id_t id);
+void telit_cmd_append(telit_cmd_t* cmd, const char* text);
+void telit_cmd_append_uint(telit_cmd_t* cmd, uint32_t value);
+void telit_cmd_arg(telit_cmd_t* cmd, const char* text);
+void telit_cmd_arg_uint(telit_cmd_t* cmd, uint32_t value);
+bool telit_cmd_end(telit_cmd_t* cmd);
+
+/**
+ * @brief The command after "AT", e.g. "#MQPUBS=1,...". It is what the
+ * parser is told to expect.
+ */
+static inline const char* telit_cmd_body(const telit_cmd_t* cmd) {
+    return cmd->buffer + 2;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef TELIT_CONFIG_H
+#define TELIT_CONFIG_H
+
+/*
+* Compile-time settings of the Telit SDK. Every value can be
+* overridden from the build system with a definition of the same name.
+*/
+
+// Size of the ring which holds the data coming from RX. It has to be a power of two.
+#ifndef TELIT_RX_RING_SIZE
+#define TELIT_RX_RING_SIZE 1024
+#endif
+
+// Size of the buffer which holds the payload of the last message read. Longer
+// payloads are cut there; mqtt_read_stream() takes them of any length.
+#ifndef TELIT_BUFFER_SIZE
+#define TELIT_BUFFER_SIZE 128
+#endif
+
+// Longest line of the modem kept by the parser. Longer lines are cut,
+// but their numeric fields are still decoded.
+#ifndef TELIT_PARSER_LINE_SIZE
+#define TELIT_PARSER_LINE_SIZE 128
+#endif
+
+// Most fields decoded from a line, e.g. 2 for "+CREG: 0,1".
+#ifndef TELIT_PARSER_MAX_FIELDS
+#define TELIT_PARSER_MAX_FIELDS 8
+#endif
+
+// Fields kept in the result of a query, e.g. 2 for "+CREG: 0,1".
+#ifndef TELIT_QUERY_MAX_FIELDS
+#define TELIT_QUERY_MAX_FIELDS 4
+#endif
+
+// Longest text field of a query, including the terminator, e.g. an IPv4 address or a broker.
+#ifndef TELIT_QUERY_TEXT_SIZE
+#define TELIT_QUERY_TEXT_SIZE 64
+#endif
+
+// Most commands waiting in the queue of telit_submit().
+#ifndef TELIT_COMMAND_QUEUE_SIZE
+#define TELIT_COMMAND_QUEUE_SIZE 8
+#endif
+
+// Longest command in the queue after "AT", including the terminator.
+#ifndef TELIT_COMMAND_SIZE
+#define TELIT_COMMAND_SIZE 128
+#endif
+
+// Longest command line sent, with "AT" and CR+LF, e.g. a #MQPUBS with its payload.
+#ifndef TELIT_COMMAND_LINE_SIZE
+#define TELIT_COMMAND_LINE_SIZE 256
+#endif
+
+// Most URC handlers, e.g. for #MQRING, +CREG and NO CARRIER.
+#ifndef TELIT_URC_MAX_HANDLERS
+#define TELIT_URC_MAX_HANDLERS 8
+#endif
+
+// Longest tag of a URC handler, including the terminator.
+#ifndef TELIT_URC_TAG_SIZE
+#define TELIT_URC_TAG_SIZE 16
+#endif
+
+// Most #MQRING announcements of a client waiting for mqtt_process_messages().
+#ifndef TELIT_MQTT_RING_QUEUE_SIZE
+#define TELIT_MQTT_RING_QUEUE_SIZE 16
+#endif
+
+// MQTT clients of a modem, on its instances 1 to this; one digit at most.
+#ifndef TELIT_MQTT_CLIENT_COUNT
+#define TELIT_MQTT_CLIENT_COUNT 2
+#endif
+
+// The MQTT session of mqtt_enable_and_configure(): keepalive seconds, and 1 for a clean session.
+#ifndef TELIT_MQTT_KEEPALIVE_S
+#define TELIT_MQTT_KEEPALIVE_S 60
+#endif
+
+#ifndef TELIT_MQTT_CLEAN_SESSION
+#define TELIT_MQTT_CLEAN_SESSION 1
+#endif
+
+// Bytes a streamed payload is sent in, see mqtt_publish_stream().
+#ifndef TELIT_STREAM_CHUNK_SIZE
+#define TELIT_STREAM_CHUNK_SIZE 64
+#endif
+
+// Highest message id mqtt_read_all() looks for in the queue of the modem.
+#ifndef TELIT_MQTT_MAX_MESSAGE_ID
+#define TELIT_MQTT_MAX_MESSAGE_ID 32
+#endif
+
+// Most keys of a publish batch, e.g. field1..field8 and status.
+#ifndef TELIT_BATCH_MAX_FIELDS
+#define TELIT_BATCH_MAX_FIELDS 10
+#endif
+
+// Longest key and value of a publish batch, including the terminators.
+#ifndef TELIT_BATCH_KEY_SIZE
+#define TELIT_BATCH_KEY_SIZE 16
+#endif
+
+#ifndef TELIT_BATCH_VALUE_SIZE
+#define TELIT_BATCH_VALUE_SIZE 32
+#endif
+
+// Longest topic, and payload of a publish batch, including the terminators.
+#ifndef TELIT_BATCH_TOPIC_SIZE
+#define TELIT_BATCH_TOPIC_SIZE 64
+#endif
+
+#ifndef TELIT_BATCH_PAYLOAD_SIZE
+#define TELIT_BATCH_PAYLOAD_SIZE 160
+#endif
+
+// The longest a probe "AT" of telit_wait_ready() waits for its answer.
+#ifndef TELIT_READY_PROBE_MS
+#define TELIT_READY_PROBE_MS 200
+#endif
+
+// Echo tests a speed of telit_negotiate_baudrate() has to pass in a row,
+// tries of going back to the speed before when it fails, and the wait for
+// the OK of "+IPR=", which a broken line never brings.
+#ifndef TELIT_BAUD_VERIFY_PROBES
+#define TELIT_BAUD_VERIFY_PROBES 3
+#endif
+
+#ifndef TELIT_BAUD_FALLBACK_TRIES
+#define TELIT_BAUD_FALLBACK_TRIES 3
+#endif
+
+#ifndef TELIT_BAUD_SWITCH_MS
+#define TELIT_BAUD_SWITCH_MS 1000
+#endif
+
+// Backoff of the network bring-up between the failed tries.
+#ifndef TELIT_ATTACH_BACKOFF_INITIAL_MS
+#define TELIT_ATTACH_BACKOFF_INITIAL_MS 500
+#endif
+
+#ifndef TELIT_ATTACH_BACKOFF_MAX_MS
+#define TELIT_ATTACH_BACKOFF_MAX_MS 16000
+#endif
+
+#ifndef TELIT_ATTACH_BACKOFF_JITTER_PERCENT
+#define TELIT_ATTACH_BACKOFF_JITTER_PERCENT 20
+#endif
+
+// Tries of a step of the network bring-up before falling back to an earlier step.
+#ifndef TELIT_ATTACH_MAX_ATTEMPTS
+#define TELIT_ATTACH_MAX_ATTEMPTS 5
+#endif
+
+// Largest page of the storage of the outbound queue; a message takes a page.
+#ifndef TELIT_STORE_PAGE_SIZE
+#define TELIT_STORE_PAGE_SIZE 256
+#endif
+
+// Command types whose latency is recorded, e.g. "+CREG" and "#MQPUBS".
+#ifndef TELIT_STATS_MAX_COMMANDS
+#define TELIT_STATS_MAX_COMMANDS 16
+#endif
+
+// Buckets of the latency histograms; bucket n holds below 2^n ms, the last one the rest.
+#ifndef TELIT_STATS_BUCKETS
+#define TELIT_STATS_BUCKETS 16
+#endif
+
+// Requests, and answers, waiting between the application and the modem
+// engine. It has to be a power of two.
+#ifndef TELIT_ENGINE_QUEUE_SIZE
+#define TELIT_ENGINE_QUEUE_SIZE 8
+#endif
+
+// Longest topic, and command or payload, of the engine, including the terminators.
+#ifndef TELIT_ENGINE_TOPIC_SIZE
+#define TELIT_ENGINE_TOPIC_SIZE 64
+#endif
+
+#ifndef TELIT_ENGINE_TEXT_SIZE
+#define TELIT_ENGINE_TEXT_SIZE 160
+#endif
+
+// Longest sleep of the engine when it has nothing to do; the modem and a request wake it earlier.
+#ifndef TELIT_ENGINE_IDLE_MS
+#define TELIT_ENGINE_IDLE_MS 10
+#endif
+
+// Records of the trace ring, 16 bytes each. It has to be a power of two.
+#ifndef TELIT_TRACE_RING_SIZE
+#define TELIT_TRACE_RING_SIZE 256
+#endif
+
+// Subsystems whose events are traced, 0 leaves their calls out of the build.
+#ifndef TELIT_TRACE_AT
+#define TELIT_TRACE_AT 1
+#endif
+
+#ifndef TELIT_TRACE_MQTT
+#define TELIT_TRACE_MQTT 1
+#endif
+
+#ifndef TELIT_TRACE_ATTACH
+#define TELIT_TRACE_ATTACH 1
+#endif
+
+#ifndef TELIT_TRACE_STORE
+#define TELIT_TRACE_STORE 1
+#endif
+
+// The UART capture of telit_capture.h, 0 leaves its calls out of the build.
+#ifndef TELIT_CAPTURE
+#define TELIT_CAPTURE 1
+#endif
+
+// Bytes of each of the two capture rings, with 5 bytes per record. It has to be a power of two.
+#ifndef TELIT_CAPTURE_RING_SIZE
+#define TELIT_CAPTURE_RING_SIZE 2048
+#endif
+
+// Time to wait at most for the modem to answer a command.
+#ifndef TELIT_MSG_WAIT_MS
+#define TELIT_MSG_WAIT_MS 5000
+#endif
+
+#endif
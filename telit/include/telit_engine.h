@@ -0,0 +1,99 @@
+#ifndef TELIT_ENGINE_H
+#define TELIT_ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+#include "telit_parser.h"
+
+/*
+* The modem engine runs the SDK on a core of its own, e.g. core1 of the
+* RP2040: the UART ISR, the commands, the URCs and the bring-up. The
+* application on the other core talks to it through two lock-free
+* single-producer/single-consumer queues, so a slow modem never holds the
+* application up.
+*
+*   application core: telit_engine_submit(), _publish(), _take()
+*   modem core:       telit_engine_start(), _step() or _run()
+*
+* Only the modem core may call the rest of the SDK. An engine drives the
+* modem, and publishes with the MQTT client, selected when it starts; the
+* engines of two modems can be stepped one after the other on the same core.
+*/
+
+typedef enum telit_engine_kind {
+    TELIT_ENGINE_COMMAND,       // An AT command; its answer is the result and the information response.
+    TELIT_ENGINE_PUBLISH,       // An MQTT publish; its answer is the result.
+    TELIT_ENGINE_MESSAGE,       // An MQTT message which has come, it is not asked for.
+} telit_engine_kind_t;
+
+typedef struct telit_engine_request {
+    uint8_t         kind;
+    uint32_t        token;      // Given back with the answer.
+    uint32_t        timeout_ms;
+    char            topic[TELIT_ENGINE_TOPIC_SIZE];
+    char            text[TELIT_ENGINE_TEXT_SIZE];   // The command after "AT", or the payload.
+} telit_engine_request_t;
+
+typedef struct telit_engine_response {
+    uint8_t         kind;
+    uint32_t        token;
+    telit_result_t  result;
+    uint16_t        length;     // Length of the text.
+    char            topic[TELIT_ENGINE_TOPIC_SIZE];
+    char            text[TELIT_ENGINE_TEXT_SIZE];   // The information response, or the payload.
+} telit_engine_response_t;
+
+struct telit_engine;
+struct telit_modem;
+struct telit_store;
+
+// Called on the modem core, e.g. to ring the other core or to run the bring-up.
+typedef void (*telit_engine_hook_t)(struct telit_engine* engine, void* user);
+
+typedef struct telit_engine {
+    // Written by the application core, read by the modem core.
+    telit_engine_request_t  requests[TELIT_ENGINE_QUEUE_SIZE];
+    volatile uint32_t       request_head;
+    volatile uint32_t       request_tail;
+
+    // Written by the modem core, read by the application core.
+    telit_engine_response_t responses[TELIT_ENGINE_QUEUE_SIZE];
+    volatile uint32_t       response_head;
+    volatile uint32_t       response_tail;
+
+    // The application core rings the modem core after a request, e.g. through the inter-core FIFO.
+    telit_engine_hook_t     wake;
+    telit_engine_hook_t     on_step;        // Work of the modem core in every step, e.g. the bring-up.
+    void*                   user;
+
+    // Modem core only.
+    uint32_t                tokens[TELIT_COMMAND_QUEUE_SIZE];   // The tokens of the commands in the queue of the SDK.
+    uint8_t                 token_head;
+    uint8_t                 in_flight;
+    struct telit_modem*     modem;          // The modem it drives, selected while it steps.
+    uint8_t                 mqtt_client;    // The MQTT client of the modem it publishes with.
+    struct telit_store*     store;          // Keeps the failed publishes, it may be NULL.
+    volatile bool           is_running;
+
+    // Statistics.
+    uint32_t                requests_done;
+    uint32_t                lost_messages;  // Messages which didn't fit in the queue of the answers.
+} telit_engine_t;
+
+void telit_engine_init(telit_engine_t* engine, telit_engine_hook_t wake, telit_engine_hook_t on_step, void* user);
+
+// The application core.
+bool telit_engine_submit(telit_engine_t* engine, const char* command, uint32_t timeout_ms, uint32_t token);
+bool telit_engine_publish(telit_engine_t* engine, const char* topic, const char* payload, uint32_t token);
+bool telit_engine_take(telit_engine_t* engine, telit_engine_response_t* response);
+void telit_engine_stop(telit_engine_t* engine);
+
+// The modem core.
+void telit_engine_start(telit_engine_t* engine);
+void telit_engine_set_store(telit_engine_t* engine, struct telit_store* store);
+bool telit_engine_step(telit_engine_t* engine);
+void telit_engine_run(telit_engine_t* engine);
+
+#endif
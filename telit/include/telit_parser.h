@@ -0,0 +1,91 @@
+#ifndef TELIT_PARSER_H
+#define TELIT_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+
+// Final result of a command.
+typedef enum telit_result {
+    TELIT_RESULT_OK,
+    TELIT_RESULT_ERROR,
+    TELIT_RESULT_CME_ERROR,     // +CME ERROR: <code>
+    TELIT_RESULT_CMS_ERROR,     // +CMS ERROR: <code>
+    TELIT_RESULT_TIMEOUT,
+} telit_result_t;
+
+typedef enum telit_event_type {
+    TELIT_EVENT_ECHO,           // The command itself, e.g. "AT+CSQ".
+    TELIT_EVENT_INFO,           // Information response, e.g. "+CSQ: 12,0".
+    TELIT_EVENT_FINAL,          // OK, ERROR, +CME ERROR: <code>.
+    TELIT_EVENT_PROMPT,         // "> ", the modem waits for raw data.
+    TELIT_EVENT_URC,            // Unsolicited result code, e.g. "#MQRING: 1,1,topic,5".
+    TELIT_EVENT_DATA,           // Raw bytes announced by the last information response.
+} telit_event_type_t;
+
+/**
+ * @brief A token of the RX stream. The line and the fields point into the
+ * parser; they are valid only while the callback runs.
+ */
+typedef struct telit_event {
+    telit_event_type_t  type;
+    const char*         line;           // The line without CR/LF, terminated. The bytes for DATA.
+    uint16_t            length;         // Length of the line, or of the bytes for DATA.
+    uint8_t             tag_length;     // Length of the part before ':', e.g. 4 for "+CSQ".
+    uint8_t             field_count;
+    int32_t             fields[TELIT_PARSER_MAX_FIELDS];        // Numeric value of every field.
+    uint16_t            field_offsets[TELIT_PARSER_MAX_FIELDS]; // Where every field starts in the line.
+    uint16_t            numeric;        // Bit of every field which is a whole number.
+    telit_result_t      result;         // FINAL only.
+} telit_event_t;
+
+struct telit_urc_table;
+
+typedef void (*telit_event_callback_t)(const telit_event_t* event, void* user);
+
+typedef enum telit_parser_state {
+    TELIT_PARSER_LINE,
+    TELIT_PARSER_DATA_MARKER,
+    TELIT_PARSER_DATA,
+} telit_parser_state_t;
+
+typedef struct telit_parser {
+    telit_parser_state_t    state;
+    telit_event_t           event;      // The line being received, its fields are decoded in place.
+    char                    line[TELIT_PARSER_LINE_SIZE];
+    uint16_t                received;   // Length of the line, including what doesn't fit in it.
+    bool                    in_fields;
+    bool                    in_quotes;
+    bool                    negative;
+    bool                    skip_space;
+    bool                    is_fields_full;
+
+    // Context of the command on the way.
+    char                    tag[16];
+    bool                    is_command_pending;
+    bool                    is_echo_pending;
+
+    // Registered URCs, they are told apart from the answer of the command.
+    const struct telit_urc_table* urcs;
+
+    // Raw data announced by an information response.
+    uint32_t                data_remaining;
+    uint8_t                 marker_index;
+
+    telit_event_callback_t  callback;
+    void*                   user;
+} telit_parser_t;
+
+void telit_parser_init(telit_parser_t* parser, telit_event_callback_t callback, void* user);
+void telit_parser_set_urcs(telit_parser_t* parser, const struct telit_urc_table* urcs);
+void telit_parser_expect(telit_parser_t* parser, const char* command);
+void telit_parser_expect_data(telit_parser_t* parser, uint32_t length);
+size_t telit_parser_feed(telit_parser_t* parser, const uint8_t* data, size_t length);
+
+bool telit_event_is(const telit_event_t* event, const char* tag);
+bool telit_event_is_number(const telit_event_t* event, uint8_t index);
+const char* telit_event_field(const telit_event_t* event, uint8_t index, uint16_t* length);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TELIT_PORT_H
+#define TELIT_PORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telit_ring.h"
+
+/**
+ * @brief Transport and clock which the SDK runs on. The Pico port binds
+ * it to the UART and the hardware timer, the host build binds it to the
+ * simulated modem.
+ */
+typedef struct telit_port {
+    // Writes the bytes to the modem. It returns once the line took every
+    // byte, waiting for room if needed: a payload follows its command line
+    // at once, so nothing may be dropped.
+    void     (*write)(void* user, const uint8_t* data, size_t length);
+    // Returns a monotonic time in microseconds.
+    uint64_t (*now_us)(void* user);
+    // Blocks for the given time. Receiving has to go on meanwhile.
+    void     (*sleep_ms)(void* user, uint32_t ms);
+    // Blocks for the given time at most. It may return early when
+    // something is received from the modem.
+    void     (*wait_ms)(void* user, uint32_t timeout_ms);
+    // Restarts the board.
+    void     (*reboot)(void* user);
+    // Changes the speed of the board's side of the line, after the bytes
+    // written are out. It returns true if the speed can't be set. It may
+    // be NULL, then the speed is never changed.
+    bool     (*set_baudrate)(void* user, uint32_t baudrate);
+    // It is passed to every function above.
+    void*    user;
+} telit_port_t;
+
+/**
+ * @brief Binds the selected modem, see telit_select(), to a port. It has
+ * to be called before any command.
+ *
+ * @param port The port to copy.
+ */
+void telit_set_port(const telit_port_t* port);
+
+/**
+ * @brief The port pushes every byte received from the selected modem into
+ * this ring, with telit_ring_push(). It is safe to do it from an ISR.
+ */
+telit_ring_t* telit_rx_ring();
+
+/**
+ * @brief Takes the received bytes out of the ring. The SDK calls it while
+ * waiting for an answer; the main loop may call it to keep the ring empty.
+ */
+void telit_process_rx();
+
+// Helpers which call the bound port.
+uint64_t telit_now_us();
+void telit_sleep_ms(uint32_t ms);
+void telit_wait_ms(uint32_t timeout_ms);
+void telit_reboot();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TELIT_QUERY_H
+#define TELIT_QUERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_cmd.h"
+#include "telit_config.h"
+#include "telit_parser.h"
+
+// Queries of the table, e.g. of the network bring-up.
+typedef enum telit_query_id {
+    TELIT_QUERY_SIGNAL,             // +CSQ: <rssi>,<ber>
+    TELIT_QUERY_CARRIER,            // +CREG: <n>,<stat>
+    TELIT_QUERY_GPRS,               // +CGREG: <n>,<stat>
+    TELIT_QUERY_GPRS_ATTACH,        // +CGATT: <state>
+    TELIT_QUERY_APN,                // +CGDCONT=1,"IP",<apn>, no information response.
+    TELIT_QUERY_PDP,                // #SGACT: <cid>,<stat>
+    TELIT_QUERY_PDP_ACTIVATE,       // #SGACT: <ip address>
+    TELIT_QUERY_MQTT_ENABLED,       // #MQEN: <instance>,<enable>
+    TELIT_QUERY_MQTT_WILL,          // #MQWCFG: <instance>,<will>,...
+    TELIT_QUERY_MQTT_CONFIG,        // #MQCFG: <instance>,<host>,<port>,<cid>
+    TELIT_QUERY_MQTT_SESSION,       // #MQCFG2: <instance>,<keepalive>,<clean session>
+    TELIT_QUERY_MQTT_STATUS,        // #MQCONN: <instance>,<stat>
+    TELIT_QUERY_COUNT,
+} telit_query_id_t;
+
+/**
+ * @brief What a query sends, and what its answer has to look like. The
+ * fields are decoded by the parser as the line arrives; the query only
+ * checks them against the schema.
+ */
+typedef struct telit_query {
+    telit_cmd_id_t  command;        // Its prefix in the table of telit_cmd.h. The argument of the query follows it in quotes.
+    const char*     tag;            // Tag of the information response, NULL if there is none.
+    uint8_t         min_fields;     // Fields the information response has at least.
+    uint8_t         numbers;        // Bit of every field which has to be a whole number.
+    int8_t          text_field;     // Field copied to the text of the result, -1 for none.
+    uint32_t        timeout_ms;
+} telit_query_t;
+
+extern const telit_query_t telit_queries[TELIT_QUERY_COUNT];
+
+// The answer of a query, it doesn't point into the parser.
+typedef struct telit_query_result {
+    telit_result_t  result;
+    uint8_t         field_count;
+    int32_t         numbers[TELIT_QUERY_MAX_FIELDS];    // Value of every numeric field.
+    char            text[TELIT_QUERY_TEXT_SIZE];        // The text field, terminated.
+} telit_query_result_t;
+
+bool telit_query_command(telit_query_id_t id, const char* arg, telit_cmd_t* cmd, char* line, uint16_t size);
+bool telit_query_decode(telit_query_id_t id, telit_result_t result, const telit_event_t* info, telit_query_result_t* answer);
+bool telit_query(telit_query_id_t id, const char* arg, telit_query_result_t* answer);
+
+#endif
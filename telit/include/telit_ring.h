@@ -0,0 +1,51 @@
+#ifndef TELIT_RING_H
+#define TELIT_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of bytes. The
+ * producer (the UART ISR) only moves the head, the consumer (the main
+ * loop) only moves the tail. The size has to be a power of two, so the
+ * free-running indices wrap with a mask.
+ */
+typedef struct telit_ring {
+    uint8_t*            data;
+    uint32_t            mask;
+    volatile uint32_t   head;       // Written by the producer only.
+    volatile uint32_t   tail;       // Written by the consumer only.
+    volatile uint32_t   overflows;  // Bytes dropped while the ring was full.
+} telit_ring_t;
+
+bool telit_ring_init(telit_ring_t* ring, uint8_t* storage, uint32_t size);
+size_t telit_ring_pop(telit_ring_t* ring, uint8_t* output, size_t length);
+size_t telit_ring_peek(telit_ring_t* ring, const uint8_t** data);
+void telit_ring_consume(telit_ring_t* ring, size_t length);
+
+static inline uint32_t telit_ring_count(const telit_ring_t* ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Producer side. It never blocks; when the ring is full the byte
+ * is dropped and counted.
+ *
+ * @return true The byte is stored.
+ * @return false The ring is full.
+ */
+static inline bool telit_ring_push(telit_ring_t* ring, uint8_t byte) {
+    uint32_t head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+        ring->overflows++;
+        return false;
+    }
+
+    ring->data[head & ring->mask] = byte;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef TELIT_STATS_H
+#define TELIT_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+#include "telit_parser.h"
+
+/**
+ * @brief Counters of a command type, e.g. "+CREG" for "+CREG?" and
+ * "+CREG=1". Bucket n of the histogram holds the latencies below 2^n ms,
+ * the last one holds the rest.
+ */
+typedef struct telit_command_stats {
+    char        tag[TELIT_URC_TAG_SIZE];
+    uint32_t    count;
+    uint32_t    errors;         // ERROR
+    uint32_t    cme_errors;     // +CME ERROR and +CMS ERROR
+    uint32_t    timeouts;
+    uint32_t    max_ms;
+    uint64_t    total_ms;
+    uint32_t    buckets[TELIT_STATS_BUCKETS];
+} telit_command_stats_t;
+
+/**
+ * @brief Latency from writing a command to its final result code, per
+ * command type. One command is timed at a time, like the modem runs them.
+ */
+typedef struct telit_stats {
+    telit_command_stats_t   commands[TELIT_STATS_MAX_COMMANDS];
+    uint8_t                 command_count;
+    uint32_t                untracked;      // Commands of the types which didn't fit.
+
+    // The command on the way.
+    int16_t                 pending;        // Index in commands, -1 if none.
+    uint64_t                started_us;
+} telit_stats_t;
+
+void telit_stats_init(telit_stats_t* stats);
+void telit_stats_begin(telit_stats_t* stats, const char* tag, uint64_t now_us);
+void telit_stats_end(telit_stats_t* stats, telit_result_t result, uint64_t now_us);
+const telit_command_stats_t* telit_stats_find(const telit_stats_t* stats, const char* tag);
+uint32_t telit_stats_percentile_ms(const telit_command_stats_t* command, uint8_t percent);
+void telit_stats_print(const telit_stats_t* stats);
+size_t telit_stats_format(const telit_stats_t* stats, char* buffer, size_t size);
+
+#endif
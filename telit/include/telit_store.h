@@ -0,0 +1,59 @@
+#ifndef TELIT_STORE_H
+#define TELIT_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+
+/**
+ * @brief Storage of the queue, with the semantics of NOR flash: a sector
+ * is erased to 0xFF, and programming a page can only clear bits. Every
+ * function returns true on failure.
+ */
+typedef struct telit_store_backend {
+    uint16_t    page_size;
+    uint16_t    pages_per_sector;
+    uint16_t    sector_count;
+    bool        (*read)(void* user, uint32_t page, uint8_t* data);
+    bool        (*program)(void* user, uint32_t page, const uint8_t* data);
+    bool        (*erase)(void* user, uint32_t sector);
+    void*       user;
+} telit_store_backend_t;
+
+// What to do when a message doesn't fit in the queue.
+typedef enum telit_store_policy {
+    TELIT_STORE_DROP_NEWEST,        // The new message is not stored.
+    TELIT_STORE_DROP_OLDEST,        // The oldest sector of messages makes room for it.
+} telit_store_policy_t;
+
+/**
+ * @brief Persistent FIFO of publishes. Every message takes a page, and the
+ * pages are written as a ring; a sent message is cleared in place, so
+ * nothing is erased until its sector is reused. The queue is found again
+ * after a reboot by its sequence numbers.
+ */
+typedef struct telit_store {
+    const telit_store_backend_t*    backend;
+    telit_store_policy_t            policy;
+    uint32_t                        page_count;
+    uint32_t                        head_page;      // The next page to write.
+    uint32_t                        tail_page;      // The oldest message, if there is.
+    uint32_t                        next_sequence;
+    uint32_t                        count;          // Messages waiting.
+
+    // Statistics.
+    uint32_t                        stored;
+    uint32_t                        sent;
+    uint32_t                        dropped;
+    uint32_t                        failures;       // Errors of the backend.
+} telit_store_t;
+
+bool telit_store_mount(telit_store_t* store, const telit_store_backend_t* backend, telit_store_policy_t policy);
+bool telit_store_push(telit_store_t* store, const char* topic, const char* payload);
+bool telit_store_peek(telit_store_t* store, char* topic, uint16_t topic_size, char* payload, uint16_t payload_size);
+bool telit_store_pop(telit_store_t* store);
+bool telit_store_publish(telit_store_t* store, const char* topic, const char* payload);
+uint32_t telit_store_forward(telit_store_t* store);
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef TELIT_TRACE_H
+#define TELIT_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+#include "telit_port.h"
+
+/*
+* Binary trace of the hot paths. An event is an id, a timestamp and three
+* raw arguments put in a RAM ring; nothing is formatted where it happens.
+* The main loop drains the ring when it is idle, and the host tool
+* telit_trace_decode turns the lines back into text.
+*
+* Every subsystem is switched on or off at compile time with its
+* TELIT_TRACE_<subsystem> setting, e.g. -DTELIT_TRACE_AT=0.
+*/
+
+// The subsystem is the high byte of the id of an event.
+typedef enum telit_trace_id {
+    TELIT_TRACE_LOST            = 0x0001,   // Records dropped while the ring was full: count.
+
+    // AT: the exchange of the commands.
+    TELIT_TRACE_CMD_WRITE       = 0x0100,   // Line length, tag[0..3], tag[4..7].
+    TELIT_TRACE_CMD_FINAL,                  // Result, tag[0..3], tag[4..7].
+    TELIT_TRACE_CMD_TIMEOUT,                // -, tag[0..3], tag[4..7].
+    TELIT_TRACE_PROMPT,
+    TELIT_TRACE_URC,                        // Line length, line[0..3], line[4..7].
+    TELIT_TRACE_RX_OVERFLOW,                // -, bytes dropped by the RX ring so far.
+    TELIT_TRACE_BAUDRATE,                   // Passed (1) or not (0), speed, -.
+
+    // MQTT: the messages.
+    TELIT_TRACE_MQTT_PUBLISH    = 0x0200,   // Kind (0 inline, 1 stream, 2 binary), length, result.
+    TELIT_TRACE_MQTT_RING,                  // Message id, announcements waiting, announcements lost so far.
+    TELIT_TRACE_MQTT_READ,                  // Message id, payload length, delivery (0 view, 1 copy, 2 sink).
+    TELIT_TRACE_MQTT_READ_ALL,              // -, messages read, messages counted.
+
+    // ATTACH: the network bring-up.
+    TELIT_TRACE_ATTACH_EVENT    = 0x0300,   // State, event, backoff ms.
+    TELIT_TRACE_ATTACH_READY,               // Answered (1) or not (0), probes sent, ms waited.
+
+    // STORE: the outbound queue.
+    TELIT_TRACE_STORE_PUSH      = 0x0400,   // -, sequence, messages waiting.
+    TELIT_TRACE_STORE_POP,                  // -, -, messages waiting.
+    TELIT_TRACE_STORE_DROP,                 // -, messages dropped so far, messages waiting.
+    TELIT_TRACE_STORE_FORWARD,              // -, messages forwarded, messages waiting.
+} telit_trace_id_t;
+
+typedef struct telit_trace_record {
+    uint32_t    time_us;        // Low 32 bits of telit_now_us().
+    uint16_t    id;
+    uint16_t    arg0;
+    uint32_t    arg1;
+    uint32_t    arg2;
+} telit_trace_record_t;
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of the records.
+ * The SDK only moves the head, the drain only moves the tail. When it is
+ * full, the new records are dropped and counted.
+ */
+typedef struct telit_trace {
+    telit_trace_record_t    records[TELIT_TRACE_RING_SIZE];
+    volatile uint32_t       head;
+    volatile uint32_t       tail;
+    volatile uint32_t       lost;
+    uint32_t                lost_reported;  // Lost records which the drain has told about.
+} telit_trace_t;
+
+extern telit_trace_t telit_trace;
+
+// Takes a line of the drain, "#T " and the record in hex, with LF.
+typedef void (*telit_trace_writer_t)(const char* line, uint16_t length, void* user);
+
+/**
+ * @brief Puts an event in the ring. Use TELIT_TRACE(), which drops the
+ * call when the subsystem is switched off.
+ */
+static inline void telit_trace_record(uint16_t id, uint16_t arg0, uint32_t arg1, uint32_t arg2) {
+    uint32_t head = telit_trace.head;
+
+    if (head - __atomic_load_n(&telit_trace.tail, __ATOMIC_ACQUIRE) >= TELIT_TRACE_RING_SIZE) {
+        telit_trace.lost++;
+        return;
+    }
+
+    telit_trace_record_t* record = &telit_trace.records[head & (TELIT_TRACE_RING_SIZE - 1)];
+    record->time_us = (uint32_t) telit_now_us();
+    record->id = id;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    record->arg2 = arg2;
+    __atomic_store_n(&telit_trace.head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Four characters of the text from the offset as one argument, e.g.
+ * a command tag; it stops at the terminator.
+ */
+static inline uint32_t telit_trace_pack(const char* text, uint8_t offset) {
+    uint32_t packed = 0;
+
+    for (uint8_t i = 0; i < offset + 4; i++) {
+        if (text[i] == '\0') break;
+        if (i >= offset) packed |= (uint32_t) (uint8_t) text[i] << (8 * (i - offset));
+    }
+    return packed;
+}
+
+// TELIT_TRACE(subsystem, id, arg0, arg1, arg2)
+#define TELIT_TRACE(subsystem, id, ...) \
+    do { if (TELIT_TRACE_##subsystem) telit_trace_record((id), __VA_ARGS__); } while (0)
+
+// A tag as the last two arguments of an event.
+#define TELIT_TRACE_TAG(tag) telit_trace_pack((tag), 0), telit_trace_pack((tag), 4)
+
+uint32_t telit_trace_drain(uint32_t time_us, uint32_t max_records, telit_trace_writer_t writer, void* user);
+uint32_t telit_trace_pending();
+bool telit_trace_parse(const char* line, telit_trace_record_t* record);
+const char* telit_trace_name(uint16_t id);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef TELIT_URC_H
+#define TELIT_URC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telit_config.h"
+#include "telit_parser.h"
+
+/**
+ * @brief Called from telit_process_rx() for every URC of its tag. It must
+ * not send commands, since a command may be waiting for its answer.
+ */
+typedef void (*telit_urc_handler_t)(const telit_event_t* event, void* user);
+
+typedef struct telit_urc_entry {
+    char                tag[TELIT_URC_TAG_SIZE];    // e.g. "#MQRING", or the whole line, e.g. "NO CARRIER".
+    telit_urc_handler_t handler;
+    void*               user;
+} telit_urc_entry_t;
+
+typedef struct telit_urc_table {
+    telit_urc_entry_t   entries[TELIT_URC_MAX_HANDLERS];
+    uint8_t             count;
+    uint32_t            unhandled;  // URCs received without a handler.
+} telit_urc_table_t;
+
+bool telit_urc_register(telit_urc_table_t* table, const char* tag, telit_urc_handler_t handler, void* user);
+bool telit_urc_unregister(telit_urc_table_t* table, const char* tag, telit_urc_handler_t handler);
+bool telit_urc_is_registered(const telit_urc_table_t* table, const telit_event_t* event);
+uint8_t telit_urc_dispatch(telit_urc_table_t* table, const telit_event_t* event);
+
+#endif
@@ -0,0 +1,205 @@
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/regs/m0plus.h"
+#include "hardware/sync.h"
+
+#include "telit_capture.h"
+#include "telit_port_pico.h"
+#include "telit_ring.h"
+
+// Registers
+#define AIRCR_Register (*((volatile uint32_t*)(PPB_BASE + 0x0ED0C)))
+#define NVIC_ISER_Register (*((volatile uint32_t*)(PPB_BASE + M0PLUS_NVIC_ISER_OFFSET)))
+
+// The interrupts of the lines, they stay on while the flash is written.
+#define PICO_LINE_IRQS ((1u << UART0_IRQ) | (1u << UART1_IRQ))
+
+// The line of a modem: its UART, and the ring its ISR pushes into.
+typedef struct pico_line {
+    uart_inst_t*    uart;
+    telit_ring_t*   ring;
+    bool            is_captured;    // The capture is of one line, the one of the default modem.
+} pico_line_t;
+
+pico_line_t pico_lines[2];                              // It holds the line of TELIT_UART, and of TELIT_UART1.
+static volatile bool is_flash_busy = false;             // It is true while the flash is written, nothing may run from it.
+
+static void pico_write(void* user, const uint8_t* data, size_t length) {
+    // It waits for room in the FIFO byte by byte, a payload follows its command line at once.
+    uart_write_blocking(((pico_line_t*) user)->uart, data, length);
+}
+
+static uint64_t pico_now_us(void* user) {
+    return time_us_64();
+}
+
+static void pico_sleep_ms(void* user, uint32_t ms) {
+    sleep_ms(ms);
+}
+
+static void pico_wait_ms(void* user, uint32_t timeout_ms) {
+    // The UART interrupt wakes the core up before the timeout.
+    best_effort_wfe_or_timeout(make_timeout_time_ms(timeout_ms));
+}
+
+static void pico_reboot(void* user) {
+    reboot_pico();
+}
+
+static bool pico_set_baudrate(void* user, uint32_t baudrate) {
+    uart_inst_t* uart = ((pico_line_t*) user)->uart;
+
+    // The bytes still in the FIFO go out at the old speed.
+    uart_tx_wait_blocking(uart);
+    uint32_t actual = uart_set_baudrate(uart, baudrate);
+
+    // The divider of the peripheral clock has to be within 2% of it.
+    return actual < baudrate - baudrate / 50 || actual > baudrate + baudrate / 50;
+}
+
+static telit_port_t pico_port(pico_line_t* line) {
+    telit_port_t port = {
+        .write = pico_write,
+        .now_us = pico_now_us,
+        .sleep_ms = pico_sleep_ms,
+        .wait_ms = pico_wait_ms,
+        .reboot = pico_reboot,
+        .set_baudrate = pico_set_baudrate,
+        .user = line,
+    };
+    return port;
+}
+
+/**
+ * @brief Opens the UART of a modem, its ISR pushes into the ring of the line.
+ */
+static void pico_uart_ready(uart_inst_t* uart, uint32_t baudrate, uint tx_pin, uint rx_pin, uint irq, irq_handler_t handler) {
+    // Open the UART channel with given baudrate.
+    uart_init(uart, baudrate);
+ 
+    // Give the UART neccecary pins which we'll use.
+    gpio_set_function(tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+    
+    // CTS and RTS are used if TELIT_UART_FLOW_CONTROL is set, on the first line only.
+    #if TELIT_UART_FLOW_CONTROL
+        if (uart == TELIT_UART) {
+            gpio_set_function(TELIT_UART_CTS_PIN, GPIO_FUNC_UART);
+            gpio_set_function(TELIT_UART_RTS_PIN, GPIO_FUNC_UART);
+        }
+    #endif
+    uart_set_hw_flow(uart, TELIT_UART_FLOW_CONTROL && uart == TELIT_UART, TELIT_UART_FLOW_CONTROL && uart == TELIT_UART);
+
+    // Set format for the UART -- 8bit data + 1bit stop, without parity.
+    uart_set_format(uart, TELIT_UART_DATABITS, TELIT_UART_STOPBITS, TELIT_UART_PARITY);
+    
+    /*
+    * Since the order of the data is important for us,
+    * we need to enable FIFO. If you'll disable it, it'll
+    * not show you real data in order -- or send it in order.
+    */
+    uart_set_fifo_enabled(uart, true);
+
+    // Set the ISR, enable it, and tell when its triggered.    
+    irq_set_exclusive_handler(irq, handler);
+    irq_set_enabled(irq, true);
+    // irq_set_priority(irq, 0);
+    uart_set_irq_enables(uart, true, false);
+}
+
+/**
+ * @brief Initilization of the TELIT modem's UART, for the default modem.
+ */
+void set_telit_uart_ready() {
+    pico_line_t* line = &pico_lines[0];
+    line->uart = TELIT_UART;
+    line->ring = &telit_default_modem()->rx_ring;
+    line->is_captured = true;
+
+    // Bind the SDK to the UART before any byte arrives.
+    telit_modem_t* selected = telit_select(telit_default_modem());
+    telit_port_t port = pico_port(line);
+    telit_set_port(&port);
+    telit_select(selected);
+
+    pico_uart_ready(TELIT_UART, TELIT_UART_BAUDRATE, TELIT_UART_TX_PIN, TELIT_UART_RX_PIN, TELIT_UART_IRQ, on_uart0_rx);
+}
+
+/**
+ * @brief Initilization of the UART of a second TELIT modem, e.g. of the
+ * other carrier. The modem is prepared here; select it to talk to it.
+ */
+void set_telit_uart1_ready(telit_modem_t* modem) {
+    pico_line_t* line = &pico_lines[1];
+    line->uart = TELIT_UART1;
+    line->ring = &modem->rx_ring;
+    line->is_captured = false;
+
+    telit_port_t port = pico_port(line);
+    telit_modem_init(modem, &port);
+
+    pico_uart_ready(TELIT_UART1, TELIT_UART1_BAUDRATE, TELIT_UART1_TX_PIN, TELIT_UART1_RX_PIN, TELIT_UART1_IRQ, on_uart1_rx);
+}
+
+/**
+ * @brief Masks every interrupt of this core but the ones of the lines,
+ * before the flash is written. Their handlers run from RAM, so the RX FIFO
+ * is still emptied into the ring while a sector is erased; the capture is
+ * skipped meanwhile, it runs from the flash. The lines have to interrupt
+ * the core which writes the flash.
+ *
+ * @return uint32_t The interrupts enabled before, for pico_flash_end().
+ */
+uint32_t pico_flash_begin() {
+    uint32_t enabled = NVIC_ISER_Register;
+    is_flash_busy = true;
+    irq_set_mask_enabled(enabled & ~PICO_LINE_IRQS, false);
+    __dsb();
+    __isb();
+    return enabled;
+}
+
+void pico_flash_end(uint32_t enabled) {
+    is_flash_busy = false;
+    irq_set_mask_enabled(enabled & ~PICO_LINE_IRQS, true);
+}
+
+/**
+ * @brief Reboots Pico using Watchdog's register.
+ * 
+ */
+void reboot_pico() {
+    /* TODO: Implement a real watchdog. */
+    AIRCR_Register = 0x5FA0004;
+}
+
+/********   Interrupt Services Routines    ********/
+// They run from RAM, with the ring push inlined, to go on while the flash is written.
+static void __attribute__((flatten)) __not_in_flash_func(pico_line_rx)(const pico_line_t* line) {
+    uart_hw_t* uart_hw = uart_get_hw(line->uart);
+    uint8_t received[32];   // As deep as the FIFO, it is captured at once.
+    uint8_t count = 0;
+
+    // Drain the whole FIFO, only the head of the ring is moved here.
+    while (!(uart_hw->fr & UART_UARTFR_RXFE_BITS)) {
+        uint8_t byte = (uint8_t) uart_hw->dr;
+        telit_ring_push(line->ring, byte);
+
+        received[count++] = byte;
+        if (count == sizeof(received)) {
+            if (line->is_captured && !is_flash_busy) TELIT_CAPTURE_RX(time_us_32(), received, count);
+            count = 0;
+        }
+    }
+
+    if (count > 0 && line->is_captured && !is_flash_busy) TELIT_CAPTURE_RX(time_us_32(), received, count);
+}
+
+void __not_in_flash_func(on_uart0_rx)() {
+    pico_line_rx(&pico_lines[0]);
+}
+
+void __not_in_flash_func(on_uart1_rx)() {
+    pico_line_rx(&pico_lines[1]);
+}
+/*************************************************/
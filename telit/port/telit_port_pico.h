@@ -0,0 +1,49 @@
+#ifndef TELIT_PORT_PICO_H
+#define TELIT_PORT_PICO_H
+
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+
+#include "telit.h"
+
+/********   UART0 TELIT MODEM SETTINGS    ********/
+#define TELIT_UART uart0
+#define TELIT_UART_BAUDRATE 115200
+#define TELIT_UART_DATABITS 8
+#define TELIT_UART_STOPBITS 1
+#define TELIT_UART_PARITY UART_PARITY_NONE
+#define TELIT_UART_TX_PIN 0
+#define TELIT_UART_RX_PIN 1
+#define TELIT_UART_CTS_PIN 18
+#define TELIT_UART_RTS_PIN 19
+#define TELIT_UART_IRQ (TELIT_UART == uart0 ? UART0_IRQ : UART1_IRQ)
+
+// RTS/CTS of the line. UART0 has them on GPIO 2 and 3 too, but GPIO 2 is
+// the button of the board.
+#ifndef TELIT_UART_FLOW_CONTROL
+#define TELIT_UART_FLOW_CONTROL 0
+#endif
+
+// Speeds the line is stepped up through at the boot, slowest first.
+#define TELIT_UART_BAUDRATES { 115200, 230400, 460800, 921600 }
+/*************************************************/
+
+/********   UART1 SECOND TELIT MODEM SETTINGS    ********/
+#define TELIT_UART1 uart1
+#define TELIT_UART1_BAUDRATE 115200
+#define TELIT_UART1_TX_PIN 4
+#define TELIT_UART1_RX_PIN 5
+#define TELIT_UART1_IRQ UART1_IRQ
+/*************************************************/
+
+void set_telit_uart_ready();
+void set_telit_uart1_ready(telit_modem_t*);
+void reboot_pico();
+uint32_t pico_flash_begin();
+void pico_flash_end(uint32_t);
+
+//-- Interrupts
+void on_uart0_rx();
+void on_uart1_rx();
+
+#endif
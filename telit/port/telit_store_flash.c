@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+#include "telit_port_pico.h"
+#include "telit_store_flash.h"
+
+// Offset of the queue from the start of the flash.
+#define STORE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - TELIT_STORE_FLASH_SECTORS * FLASH_SECTOR_SIZE)
+
+static bool flash_read(void* user, uint32_t page, uint8_t* data) {
+    // The flash is mapped to the memory, it is read as it is.
+    memcpy(data, (const uint8_t*) (uintptr_t) (XIP_BASE + STORE_FLASH_OFFSET + page * FLASH_PAGE_SIZE), FLASH_PAGE_SIZE);
+    return false;
+}
+
+/**
+ * @brief Nothing may run from the flash while it is written: the other
+ * core is held in RAM if it has called multicore_lockout_victim_init(),
+ * and every interrupt of this core but the ones of the modem lines is
+ * masked. An erase takes tens of ms, far more than the 32 bytes of the RX
+ * FIFO last, so the lines are still emptied meanwhile, from RAM.
+ */
+static uint32_t flash_lock() {
+    if (multicore_lockout_victim_is_initialized(get_core_num() ^ 1))
+        multicore_lockout_start_blocking();
+    return pico_flash_begin();
+}
+
+static void flash_unlock(uint32_t interrupts) {
+    pico_flash_end(interrupts);
+    if (multicore_lockout_victim_is_initialized(get_core_num() ^ 1))
+        multicore_lockout_end_blocking();
+}
+
+static bool flash_program(void* user, uint32_t page, const uint8_t* data) {
+    uint32_t interrupts = flash_lock();
+    flash_range_program(STORE_FLASH_OFFSET + page * FLASH_PAGE_SIZE, data, FLASH_PAGE_SIZE);
+    flash_unlock(interrupts);
+    return false;
+}
+
+static bool flash_erase(void* user, uint32_t sector) {
+    uint32_t interrupts = flash_lock();
+    flash_range_erase(STORE_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    flash_unlock(interrupts);
+    return false;
+}
+
+static const telit_store_backend_t flash_backend = {
+    .page_size = FLASH_PAGE_SIZE,
+    .pages_per_sector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE,
+    .sector_count = TELIT_STORE_FLASH_SECTORS,
+    .read = flash_read,
+    .program = flash_program,
+    .erase = flash_erase,
+    .user = NULL,
+};
+
+/**
+ * @brief The last TELIT_STORE_FLASH_SECTORS sectors of the on-board flash.
+ * Only the interrupts of the modem lines are on while a page is programmed
+ * or a sector is erased, so the store has to be written on the core which
+ * takes them, core1 of the firmware; their bytes are lost else. If both
+ * cores run, the other one has to call multicore_lockout_victim_init().
+ */
+const telit_store_backend_t* telit_store_flash() {
+    return &flash_backend;
+}
@@ -0,0 +1,15 @@
+#ifndef TELIT_STORE_FLASH_H
+#define TELIT_STORE_FLASH_H
+
+#include "telit_store.h"
+
+/********   OUTBOUND QUEUE FLASH SETTINGS    ********/
+// Sectors at the end of the flash which hold the queue, they must be left out of the program.
+#ifndef TELIT_STORE_FLASH_SECTORS
+#define TELIT_STORE_FLASH_SECTORS 8
+#endif
+/****************************************************/
+
+const telit_store_backend_t* telit_store_flash();
+
+#endif
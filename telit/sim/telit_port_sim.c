@@ -0,0 +1,71 @@
+#include <stdio.h>
+
+#include "telit.h"
+#include "telit_capture.h"
+#include "telit_ring.h"
+#include "telit_sim.h"
+
+static void sim_port_write(void* user, const uint8_t* data, size_t length) {
+    telit_sim_t* sim = (telit_sim_t*) user;
+
+    // Same as uart_write_blocking(), the clock goes on until the FIFO has room.
+    while (length > 0) {
+        size_t room = telit_sim_tx_room(sim);
+        if (room == 0) {
+            telit_sim_tx_wait(sim);
+            continue;
+        }
+
+        size_t size = (length < room) ? length : room;
+        telit_sim_write(sim, data, size);
+        data += size;
+        length -= size;
+    }
+}
+
+static uint64_t sim_port_now_us(void* user) {
+    return ((telit_sim_t*) user)->now_us;
+}
+
+static void sim_port_sleep_ms(void* user, uint32_t ms) {
+    telit_sim_advance((telit_sim_t*) user, (uint64_t) ms * 1000);
+}
+
+static void sim_port_wait_ms(void* user, uint32_t timeout_ms) {
+    telit_sim_wait((telit_sim_t*) user, (uint64_t) timeout_ms * 1000);
+}
+
+static void sim_port_reboot(void* user) {
+    // The board keeps running on the host, the reboot is only counted.
+    ((telit_sim_t*) user)->reboots++;
+}
+
+static bool sim_port_set_baudrate(void* user, uint32_t baudrate) {
+    ((telit_sim_t*) user)->board_baudrate = baudrate;
+    return false;
+}
+
+static void sim_port_rx(void* user, uint64_t time_us, const uint8_t* data, size_t length) {
+    // Same as the UART ISR, only the ring is touched.
+    telit_ring_t* ring = (telit_ring_t*) user;
+    for (size_t i = 0; i < length; i++)
+        telit_ring_push(ring, data[i]);
+
+    // The capture is of one line, the one of the default modem.
+    if (ring == &telit_default_modem()->rx_ring) TELIT_CAPTURE_RX((uint32_t) time_us, data, length);
+}
+
+void telit_sim_attach(telit_sim_t* sim) {
+    telit_port_t port = {
+        .write = sim_port_write,
+        .now_us = sim_port_now_us,
+        .sleep_ms = sim_port_sleep_ms,
+        .wait_ms = sim_port_wait_ms,
+        .reboot = sim_port_reboot,
+        .set_baudrate = sim_port_set_baudrate,
+        .user = sim,
+    };
+
+    telit_sim_set_rx(sim, sim_port_rx, telit_rx_ring());
+    telit_set_port(&port);
+}
@@ -0,0 +1,691 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telit_sim.h"
+
+/**
+ * @brief Time the bytes take on the line, 10 bits each with the start and
+ * the stop bit.
+ */
+static uint64_t sim_wire_us(uint32_t baudrate, size_t length) {
+    return (baudrate > 0) ? (uint64_t) length * 10 * 1000000 / baudrate : 0;
+}
+
+/**
+ * @brief The line breaks a byte if its two ends run at different speeds,
+ * and one in TELIT_SIM_ERROR_INTERVAL above the speed the wiring carries.
+ * The board's side follows the modem until the board sets its speed.
+ */
+static bool sim_is_broken(telit_sim_t* sim, uint32_t sent_baudrate, uint32_t received_baudrate) {
+    bool is_broken = sent_baudrate != received_baudrate
+        || (sim->max_baudrate > 0 && sent_baudrate > sim->max_baudrate && sim->line_bytes % TELIT_SIM_ERROR_INTERVAL == 0);
+
+    sim->line_bytes++;
+    if (is_broken) sim->broken_bytes++;
+    return is_broken;
+}
+
+// The speeds +IPR= takes; a line broken on the way doesn't turn into a speed.
+static bool sim_is_baudrate(uint32_t baudrate) {
+    static const uint32_t baudrates[] = { 300, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
+
+    for (size_t i = 0; i < sizeof(baudrates) / sizeof(baudrates[0]); i++)
+        if (baudrates[i] == baudrate) return true;
+    return false;
+}
+
+static uint32_t sim_board_baudrate(const telit_sim_t* sim) {
+    return (sim->board_baudrate > 0) ? sim->board_baudrate : sim->baudrate;
+}
+
+/**
+ * @brief Puts the bytes on the wire to the board after the given latency.
+ * Answers never overtake each other, like on a real serial line.
+ */
+static bool sim_schedule(telit_sim_t* sim, uint32_t latency_ms, const uint8_t* data, size_t length) {
+    if (sim->chunk_count == TELIT_SIM_MAX_CHUNKS || length > TELIT_SIM_CHUNK_SIZE)
+        return false;
+
+    uint64_t due_us = sim->now_us + (uint64_t) latency_ms * 1000;
+    if (due_us < sim->busy_until_us) due_us = sim->busy_until_us;
+    sim->busy_until_us = due_us + sim_wire_us(sim->baudrate, length);
+
+    telit_sim_chunk_t* chunk = &sim->chunks[sim->chunk_count++];
+    chunk->due_us = due_us;
+    chunk->sequence = sim->sequence++;
+    chunk->length = length;
+    chunk->offset = 0;
+    chunk->baudrate = sim->baudrate;
+    memcpy(chunk->data, data, length);
+    return true;
+}
+
+static void sim_answer(telit_sim_t* sim, uint32_t latency_ms, const char* format, ...) {
+    char answer[TELIT_SIM_CHUNK_SIZE];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(answer, sizeof(answer), format, args);
+    va_end(args);
+
+    if (length > 0)
+        sim_schedule(sim, latency_ms, (const uint8_t*) answer, length);
+}
+
+static void sim_ok(telit_sim_t* sim, uint32_t latency_ms) {
+    sim_answer(sim, latency_ms, "\r\nOK\r\n");
+}
+
+static void sim_error(telit_sim_t* sim, uint32_t latency_ms) {
+    sim_answer(sim, latency_ms, "\r\nERROR\r\n");
+}
+
+static uint32_t sim_latency_of(telit_sim_t* sim, const char* command) {
+    for (int i = 0; i < TELIT_SIM_MAX_LATENCIES; i++) {
+        telit_sim_latency_t* latency = &sim->latencies[i];
+        if (latency->command[0] != '\0' && strncmp(command, latency->command, strlen(latency->command)) == 0)
+            return latency->latency_ms;
+    }
+    return sim->latency_ms;
+}
+
+/**
+ * @brief Splits the arguments of a command at the commas. The last field
+ * takes the rest of the line, so a payload may contain commas.
+ *
+ * @return uint8_t The number of the fields.
+ */
+static uint8_t sim_split(char* arguments, char* fields[], uint8_t max_fields) {
+    uint8_t count = 0;
+    char* cursor = arguments;
+
+    while (count < max_fields) {
+        fields[count++] = cursor;
+        if (count == max_fields) break;
+        char* comma = strchr(cursor, ',');
+        if (comma == NULL) break;
+        *comma = '\0';
+        cursor = comma + 1;
+    }
+    return count;
+}
+
+static void sim_unquote(char* field) {
+    size_t length = strlen(field);
+    if (length >= 2 && field[0] == '"' && field[length - 1] == '"') {
+        memmove(field, field + 1, length - 2);
+        field[length - 2] = '\0';
+    }
+}
+
+/**
+ * @brief The client of the instance in the first field, e.g. 2 of "#MQCONN=2,...".
+ *
+ * @return telit_sim_mqtt_t* NULL if there is no such instance.
+ */
+static telit_sim_mqtt_t* sim_mqtt_of(telit_sim_t* sim, const char* field) {
+    int instance = atoi(field);
+    if (instance < 1 || instance > TELIT_SIM_MQTT_INSTANCES) return NULL;
+    return &sim->mqtt[instance - 1];
+}
+
+// The publish comes back to the subscriptions of the client which sent it.
+static void sim_publish(telit_sim_t* sim, uint8_t instance, const char* topic, const uint8_t* payload, uint16_t length) {
+    sim->publishes++;
+    if (!sim->loopback) return;
+
+    const telit_sim_mqtt_t* mqtt = &sim->mqtt[instance - 1];
+    for (int i = 0; i < TELIT_SIM_MAX_SUBSCRIPTIONS; i++) {
+        if (mqtt->subscriptions[i][0] != '\0')
+            telit_sim_queue_message(sim, instance, mqtt->subscriptions[i], payload, length);
+    }
+}
+
+static void sim_mqtt_read(telit_sim_t* sim, uint32_t latency, int instance, int message_id) {
+    if (message_id < 1 || message_id > TELIT_SIM_MAX_MESSAGES || !sim->messages[message_id - 1].used
+        || sim->messages[message_id - 1].instance != instance) {
+        sim_error(sim, latency);
+        return;
+    }
+
+    telit_sim_message_t* message = &sim->messages[message_id - 1];
+    uint8_t answer[TELIT_SIM_CHUNK_SIZE];
+    int length = snprintf((char*) answer, sizeof(answer), "\r\n#MQREAD: %d,%s,%u\r\n<<<", instance, message->topic, message->length);
+    memcpy(answer + length, message->payload, message->length);
+    length += message->length;
+    memcpy(answer + length, "\r\nOK\r\n", 6);
+    length += 6;
+
+    sim_schedule(sim, latency, answer, length);
+    message->used = false;
+}
+
+/**
+ * @brief Answers a read of the MQTT settings with a line for every
+ * instance, e.g. "#MQEN: 1,1" and "#MQEN: 2,0", as the modem does.
+ */
+static void sim_answer_instances(telit_sim_t* sim, uint32_t latency, const char* command) {
+    char answer[TELIT_SIM_CHUNK_SIZE] = "\r\n";
+    size_t length = 2;
+
+    for (int i = 0; i < TELIT_SIM_MQTT_INSTANCES && length < sizeof(answer); i++) {
+        const telit_sim_mqtt_t* mqtt = &sim->mqtt[i];
+        char* line = answer + length;
+        size_t room = sizeof(answer) - length;
+
+        if (strcmp(command, "#MQEN?") == 0)
+            length += snprintf(line, room, "#MQEN: %d,%u\r\n", i + 1, mqtt->enabled ? 1 : 0);
+        else if (strcmp(command, "#MQWCFG?") == 0)
+            length += snprintf(line, room, "#MQWCFG: %d,%u,0,0\r\n", i + 1, mqtt->last_will ? 1 : 0);
+        else if (strcmp(command, "#MQCFG2?") == 0)
+            length += snprintf(line, room, "#MQCFG2: %d,%u,%u\r\n", i + 1, mqtt->keepalive_s, mqtt->clean_session ? 1 : 0);
+        else if (strcmp(command, "#MQCFG?") == 0)
+            length += snprintf(line, room, "#MQCFG: %d,\"%s\",%u,1\r\n", i + 1, mqtt->broker, mqtt->port);
+        else if (strcmp(command, "#MQCONN?") == 0)
+            length += snprintf(line, room, "#MQCONN: %d,%u\r\n", i + 1, mqtt->connected ? 1 : 0);
+        else {
+            uint8_t queued = 0;
+            for (int j = 0; j < TELIT_SIM_MAX_MESSAGES; j++)
+                if (sim->messages[j].used && sim->messages[j].instance == i + 1) queued++;
+            length += snprintf(line, room, "#MQREAD: %d,%u\r\n", i + 1, queued);
+        }
+    }
+
+    sim_answer(sim, latency, "%s\r\nOK\r\n", answer);
+}
+
+/**
+ * @brief Models the modem for a command without the "AT" part.
+ */
+static void sim_execute(telit_sim_t* sim, char* command) {
+    uint32_t latency = sim_latency_of(sim, command);
+    char* fields[6];
+    uint8_t count;
+
+    sim->commands++;
+
+    // Scripted answers come first.
+    for (int i = 0; i < TELIT_SIM_MAX_RULES; i++) {
+        telit_sim_rule_t* rule = &sim->rules[i];
+        if (!rule->used || strncmp(command, rule->command, strlen(rule->command)) != 0)
+            continue;
+
+        sim_answer(sim, rule->latency_ms, "%s", rule->response);
+        if (rule->remaining > 0 && --rule->remaining == 0)
+            rule->used = false;
+        return;
+    }
+
+    if (command[0] == '\0') {
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "E0") == 0 || strcmp(command, "E1") == 0) {
+        sim->echo = command[1] == '1';
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "&K0") == 0 || strcmp(command, "&K3") == 0) {
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "+IPR?") == 0) {
+        sim_answer(sim, latency, "\r\n+IPR: %u\r\n\r\nOK\r\n", sim->baudrate);
+    }
+    else if (strncmp(command, "+IPR=", 5) == 0) {
+        // The OK still goes at the old speed, the next byte at the new one.
+        uint32_t baudrate = strtoul(command + 5, NULL, 10);
+        if (!sim_is_baudrate(baudrate)) {
+            sim_error(sim, latency);
+        } else {
+            sim_ok(sim, latency);
+            sim->baudrate = baudrate;
+        }
+    }
+    else if (strcmp(command, "+CSQ") == 0) {
+        sim_answer(sim, latency, "\r\n+CSQ: %u,0\r\n\r\nOK\r\n", sim->signal_quality);
+    }
+    else if (strcmp(command, "+CREG?") == 0) {
+        sim_answer(sim, latency, "\r\n+CREG: %u,%u\r\n\r\nOK\r\n", sim->creg_mode, sim->creg_status);
+    }
+    else if (strncmp(command, "+CREG=", 6) == 0) {
+        sim->creg_mode = atoi(command + 6);
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "+CGREG?") == 0) {
+        sim_answer(sim, latency, "\r\n+CGREG: %u,%u\r\n\r\nOK\r\n", sim->cgreg_mode, sim->cgreg_status);
+    }
+    else if (strncmp(command, "+CGREG=", 7) == 0) {
+        sim->cgreg_mode = atoi(command + 7);
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "+CGATT?") == 0) {
+        sim_answer(sim, latency, "\r\n+CGATT: %u\r\n\r\nOK\r\n", sim->cgatt_status);
+    }
+    else if (strncmp(command, "+CGDCONT=", 9) == 0) {
+        sim->apn_defined = true;
+        sim_ok(sim, latency);
+    }
+    else if (strcmp(command, "#SGACT?") == 0) {
+        // A line for every context, as the modem does.
+        char answer[TELIT_SIM_PDP_CONTEXTS * 16] = "";
+        size_t length = 0;
+        for (int i = 1; i <= TELIT_SIM_PDP_CONTEXTS; i++)
+            length += snprintf(answer + length, sizeof(answer) - length, "#SGACT: %d,%u\r\n", i, (i == 1 && sim->pdp_active) ? 1 : 0);
+        sim_answer(sim, latency, "\r\n%s\r\nOK\r\n", answer);
+    }
+    else if (strncmp(command, "#SGACT=", 7) == 0) {
+        count = sim_split(command + 7, fields, 2);
+        bool activate = count == 2 && atoi(fields[1]) == 1;
+
+        if (activate && (!sim->apn_defined || sim->pdp_active || sim->cgatt_status != 1)) {
+            sim_error(sim, latency);
+        } else if (activate) {
+            sim->pdp_active = true;
+            sim_answer(sim, latency, "\r\n#SGACT: 10.64.12.7\r\n\r\nOK\r\n");
+        } else {
+            sim->pdp_active = false;
+            for (int i = 0; i < TELIT_SIM_MQTT_INSTANCES; i++)
+                sim->mqtt[i].connected = false;
+            sim_ok(sim, latency);
+        }
+    }
+    else if (strcmp(command, "#MQEN?") == 0 || strcmp(command, "#MQWCFG?") == 0 || strcmp(command, "#MQCFG?") == 0
+             || strcmp(command, "#MQCFG2?") == 0 || strcmp(command, "#MQCONN?") == 0 || strcmp(command, "#MQREAD?") == 0) {
+        sim_answer_instances(sim, latency, command);
+    }
+    else if (strncmp(command, "#MQ", 3) == 0 && strchr(command, '=') != NULL) {
+        // The instance of the client is the first field of every set command.
+        char* arguments = strchr(command, '=') + 1;
+        count = sim_split(arguments, fields, 5);
+        telit_sim_mqtt_t* mqtt = sim_mqtt_of(sim, fields[0]);
+        uint8_t instance = (mqtt != NULL) ? mqtt - sim->mqtt + 1 : 0;
+
+        if (mqtt == NULL) {
+            sim_error(sim, latency);
+        }
+        else if (strncmp(command, "#MQEN=", 6) == 0) {
+            mqtt->enabled = count >= 2 && atoi(fields[1]) == 1;
+            sim_ok(sim, latency);
+        }
+        else if (strncmp(command, "#MQWCFG=", 8) == 0) {
+            mqtt->last_will = count >= 2 && atoi(fields[1]) == 1;
+            sim_ok(sim, latency);
+        }
+        else if (strncmp(command, "#MQCFG2=", 8) == 0) {
+            if (!mqtt->enabled || count < 3) {
+                sim_error(sim, latency);
+            } else {
+                mqtt->keepalive_s = atoi(fields[1]);
+                mqtt->clean_session = atoi(fields[2]) == 1;
+                sim_ok(sim, latency);
+            }
+        }
+        else if (strncmp(command, "#MQCFG=", 7) == 0) {
+            if (!mqtt->enabled || count < 3) {
+                sim_error(sim, latency);
+            } else {
+                sim_unquote(fields[1]);
+                snprintf(mqtt->broker, sizeof(mqtt->broker), "%s", fields[1]);
+                mqtt->port = atoi(fields[2]);
+                mqtt->configured = true;
+                sim_ok(sim, latency);
+            }
+        }
+        else if (strncmp(command, "#MQCONN=", 8) == 0) {
+            if (!mqtt->configured || !sim->pdp_active) {
+                sim_error(sim, latency);
+            } else {
+                mqtt->connected = true;
+                sim_ok(sim, latency);
+            }
+        }
+        else if (strncmp(command, "#MQDISC=", 8) == 0) {
+            mqtt->connected = false;
+            sim_ok(sim, latency);
+        }
+        else if (strncmp(command, "#MQSUB=", 7) == 0) {
+            if (!mqtt->connected || count < 2) {
+                sim_error(sim, latency);
+                return;
+            }
+            sim_unquote(fields[1]);
+            for (int i = 0; i < TELIT_SIM_MAX_SUBSCRIPTIONS; i++) {
+                if (mqtt->subscriptions[i][0] == '\0' || strcmp(mqtt->subscriptions[i], fields[1]) == 0) {
+                    snprintf(mqtt->subscriptions[i], TELIT_SIM_TOPIC_SIZE, "%s", fields[1]);
+                    break;
+                }
+            }
+            sim_ok(sim, latency);
+        }
+        else if (strncmp(command, "#MQPUBS=", 8) == 0) {
+            if (!mqtt->connected || count < 5) {
+                sim_error(sim, latency);
+                return;
+            }
+            sim_unquote(fields[1]);
+            sim_publish(sim, instance, fields[1], (const uint8_t*) fields[4], strlen(fields[4]));
+            sim_ok(sim, latency);
+        }
+        else if (strncmp(command, "#MQPUBSBIN=", 11) == 0) {
+            int length = (count == 5) ? atoi(fields[4]) : 0;
+            if (!mqtt->connected || length <= 0 || length > TELIT_SIM_PAYLOAD_SIZE) {
+                sim_error(sim, latency);
+                return;
+            }
+            sim_unquote(fields[1]);
+            sim->binary_instance = instance;
+            snprintf(sim->binary_topic, sizeof(sim->binary_topic), "%s", fields[1]);
+            sim->binary_length = 0;
+            sim->binary_remaining = length;
+            sim_answer(sim, latency, "\r\n> ");
+            sim->binary_from_us = sim->busy_until_us;
+        }
+        else if (strncmp(command, "#MQREAD=", 8) == 0) {
+            sim_mqtt_read(sim, latency, instance, count == 2 ? atoi(fields[1]) : 0);
+        }
+        else {
+            sim_error(sim, latency);
+        }
+    }
+    else {
+        sim_error(sim, latency);
+    }
+}
+
+/**
+ * @brief Ends the command at the next ';' outside quotes.
+ *
+ * @return char* The command after it, NULL if it is the last one.
+ */
+static char* sim_next_command(char* command) {
+    bool in_quotes = false;
+
+    for (char* c = command; *c != '\0'; c++) {
+        if (*c == '"') in_quotes = !in_quotes;
+        else if (*c == ';' && !in_quotes) {
+            *c = '\0';
+            return c + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs the commands of a line, e.g. "#MQEN?;#MQCFG?". They share
+ * the final result code of the last one; an error ends the line.
+ */
+static void sim_execute_line(telit_sim_t* sim, char* line) {
+    char* command = line;
+    char* next;
+
+    while ((next = sim_next_command(command)) != NULL) {
+        uint32_t sequence = sim->sequence;
+        sim_execute(sim, command);
+
+        // The answer is the last chunk; its "OK" is taken off.
+        telit_sim_chunk_t* answer = NULL;
+        for (int i = 0; i < sim->chunk_count; i++)
+            if (sim->chunks[i].sequence >= sequence) answer = &sim->chunks[i];
+        if (answer == NULL || answer->length < 6 || memcmp(answer->data + answer->length - 6, "\r\nOK\r\n", 6) != 0)
+            return;
+
+        answer->length -= 6;
+        if (answer->length == 0) *answer = sim->chunks[--sim->chunk_count];
+        command = next;
+    }
+
+    sim_execute(sim, command);
+}
+
+static void sim_on_line(telit_sim_t* sim) {
+    sim->line[sim->line_length] = '\0';
+    // Still starting up, not even the echo comes back.
+    if (sim->now_us < (uint64_t) sim->boot_ms * 1000) return;
+
+    if (sim->echo) {
+        sim->line[sim->line_length] = '\r';
+        sim_schedule(sim, 0, (const uint8_t*) sim->line, sim->line_length + 1);
+        sim->line[sim->line_length] = '\0';
+    }
+
+    if ((sim->line[0] == 'A' || sim->line[0] == 'a') && (sim->line[1] == 'T' || sim->line[1] == 't'))
+        sim_execute_line(sim, sim->line + 2);
+}
+
+void telit_sim_init(telit_sim_t* sim) {
+    memset(sim, 0, sizeof(*sim));
+    sim->latency_ms = 30;
+    sim->baudrate = 115200;
+    sim->signal_quality = 18;
+    sim->creg_status = 1;
+    sim->cgreg_status = 1;
+    sim->cgatt_status = 1;
+    sim->echo = true;
+    sim->loopback = true;
+    sim->ring = true;
+    for (int i = 0; i < TELIT_SIM_MQTT_INSTANCES; i++) {
+        sim->mqtt[i].keepalive_s = 60;
+        sim->mqtt[i].clean_session = true;
+    }
+}
+
+void telit_sim_set_rx(telit_sim_t* sim, telit_sim_rx_t rx, void* user) {
+    sim->rx = rx;
+    sim->rx_user = user;
+}
+
+/**
+ * @brief Sets the latency of the commands which start with the given text,
+ * e.g. "#MQCONN" or "+CREG?".
+ */
+bool telit_sim_set_latency(telit_sim_t* sim, const char* command, uint32_t latency_ms) {
+    for (int i = 0; i < TELIT_SIM_MAX_LATENCIES; i++) {
+        telit_sim_latency_t* latency = &sim->latencies[i];
+        if (latency->command[0] == '\0' || strcmp(latency->command, command) == 0) {
+            snprintf(latency->command, sizeof(latency->command), "%s", command);
+            latency->latency_ms = latency_ms;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Answers the commands which start with the given text with the
+ * given raw response, instead of the modem model.
+ *
+ * @param count How many times the rule applies. 0 means forever.
+ */
+bool telit_sim_script(telit_sim_t* sim, const char* command, const char* response, uint32_t latency_ms, uint32_t count) {
+    for (int i = 0; i < TELIT_SIM_MAX_RULES; i++) {
+        telit_sim_rule_t* rule = &sim->rules[i];
+        if (rule->used) continue;
+
+        snprintf(rule->command, sizeof(rule->command), "%s", command);
+        snprintf(rule->response, sizeof(rule->response), "%s", response);
+        rule->latency_ms = latency_ms;
+        rule->remaining = count;
+        rule->used = true;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Sends unsolicited text to the board after the given delay.
+ */
+bool telit_sim_inject(telit_sim_t* sim, uint32_t delay_ms, const char* text) {
+    return sim_schedule(sim, delay_ms, (const uint8_t*) text, strlen(text));
+}
+
+/**
+ * @brief Changes the registration of the modem, e.g. to model the loss of
+ * the coverage. The changes are reported with URCs if they are enabled.
+ */
+void telit_sim_set_registration(telit_sim_t* sim, uint8_t creg_status, uint8_t cgreg_status) {
+    if (sim->creg_mode > 0 && creg_status != sim->creg_status)
+        sim_answer(sim, 0, "\r\n+CREG: %u\r\n", creg_status);
+    if (sim->cgreg_mode > 0 && cgreg_status != sim->cgreg_status)
+        sim_answer(sim, 0, "\r\n+CGREG: %u\r\n", cgreg_status);
+
+    sim->creg_status = creg_status;
+    sim->cgreg_status = cgreg_status;
+}
+
+/**
+ * @brief Stores a downlink message of the MQTT client in the lowest free
+ * slot of the modem, and announces it with
+ * "#MQRING: <instance>,<id>,<topic>,<length>".
+ *
+ * @param instance The client it comes to, from 1 to TELIT_SIM_MQTT_INSTANCES.
+ * @return int The message id to use with #MQREAD, or -1 if the modem is full.
+ */
+int telit_sim_queue_message(telit_sim_t* sim, uint8_t instance, const char* topic, const uint8_t* payload, uint16_t length) {
+    if (length > TELIT_SIM_PAYLOAD_SIZE || instance < 1 || instance > TELIT_SIM_MQTT_INSTANCES) return -1;
+
+    for (int i = 0; i < TELIT_SIM_MAX_MESSAGES; i++) {
+        telit_sim_message_t* message = &sim->messages[i];
+        if (message->used) continue;
+
+        snprintf(message->topic, sizeof(message->topic), "%s", topic);
+        memcpy(message->payload, payload, length);
+        message->length = length;
+        message->instance = instance;
+        message->used = true;
+
+        if (sim->ring)
+            sim_answer(sim, 0, "\r\n#MQRING: %u,%d,%s,%u\r\n", instance, i + 1, message->topic, length);
+        return i + 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief The free room of the board's TX FIFO. The FIFO empties at the
+ * speed of the board's side of the line.
+ *
+ * @return size_t The bytes which can be written without an overrun.
+ */
+size_t telit_sim_tx_room(const telit_sim_t* sim) {
+    uint32_t baudrate = sim_board_baudrate(sim);
+    if (baudrate == 0 || sim->tx_until_us <= sim->now_us) return TELIT_SIM_TX_FIFO;
+
+    // A byte partly on the wire still takes its place, 10 bits each.
+    uint64_t queued = ((sim->tx_until_us - sim->now_us) * baudrate + 10 * 1000000 - 1) / (10 * 1000000);
+    return (queued < TELIT_SIM_TX_FIFO) ? TELIT_SIM_TX_FIFO - queued : 0;
+}
+
+/**
+ * @brief Moves the clock forward until the board's TX FIFO has room for a
+ * byte, and delivers what is due meanwhile.
+ */
+void telit_sim_tx_wait(telit_sim_t* sim) {
+    uint64_t fifo_us = sim_wire_us(sim_board_baudrate(sim), TELIT_SIM_TX_FIFO - 1);
+    if (sim->tx_until_us > sim->now_us + fifo_us)
+        telit_sim_advance(sim, sim->tx_until_us - fifo_us - sim->now_us);
+}
+
+/**
+ * @brief The board writes to the modem through its TX FIFO, as to the data
+ * register of the UART: the bytes which don't fit are lost. Commands are
+ * executed at the carriage return.
+ */
+void telit_sim_write(telit_sim_t* sim, const uint8_t* data, size_t length) {
+    size_t room = telit_sim_tx_room(sim);
+    if (length > room) {
+        sim->tx_overruns += length - room;
+        length = room;
+    }
+
+    if (sim->tx_until_us < sim->now_us) sim->tx_until_us = sim->now_us;
+    sim->tx_until_us += sim_wire_us(sim_board_baudrate(sim), length);
+    sim->tx_bytes += length;
+
+    for (size_t i = 0; i < length; i++) {
+        // A byte broken on the line is a framing error, the modem drops it.
+        if (sim_is_broken(sim, sim_board_baudrate(sim), sim->baudrate)) continue;
+
+        // The bytes after the prompt of #MQPUBSBIN are the payload, whatever they are.
+        if (sim->binary_remaining > 0) {
+            if (sim->now_us < sim->binary_from_us) continue;
+            sim->binary[sim->binary_length++] = data[i];
+            if (--sim->binary_remaining == 0) {
+                sim_publish(sim, sim->binary_instance, sim->binary_topic, sim->binary, sim->binary_length);
+                sim_ok(sim, sim_latency_of(sim, "#MQPUBSBIN"));
+            }
+            continue;
+        }
+
+        if (data[i] == '\r') {
+            sim_on_line(sim);
+            sim->line_length = 0;
+        } else if (data[i] != '\n' && sim->line_length < TELIT_SIM_LINE_SIZE - 1) {
+            sim->line[sim->line_length++] = data[i];
+        }
+    }
+}
+
+/**
+ * @brief Delivers a burst of the earliest chunk which is due until the
+ * given time. The rest of the chunk follows as the line carries it.
+ *
+ * @return true A burst is delivered.
+ * @return false Nothing is due.
+ */
+static bool sim_deliver_next(telit_sim_t* sim, uint64_t target_us) {
+    int next = -1;
+    for (int i = 0; i < sim->chunk_count; i++) {
+        telit_sim_chunk_t* chunk = &sim->chunks[i];
+        if (chunk->due_us > target_us) continue;
+        if (next < 0 || chunk->due_us < sim->chunks[next].due_us
+            || (chunk->due_us == sim->chunks[next].due_us && chunk->sequence < sim->chunks[next].sequence))
+            next = i;
+    }
+    if (next < 0) return false;
+
+    // Copy the burst out, since the board may answer from the receiver.
+    telit_sim_chunk_t* chunk = &sim->chunks[next];
+    uint8_t burst[TELIT_SIM_RX_BURST];
+    uint16_t length = chunk->length - chunk->offset;
+    if (length > TELIT_SIM_RX_BURST) length = TELIT_SIM_RX_BURST;
+    memcpy(burst, chunk->data + chunk->offset, length);
+
+    // The burst is there once its last byte is on the wire.
+    uint32_t board_baudrate = (sim->board_baudrate > 0) ? sim->board_baudrate : chunk->baudrate;
+    for (uint16_t i = 0; i < length; i++)
+        if (sim_is_broken(sim, chunk->baudrate, board_baudrate)) burst[i] = TELIT_SIM_BROKEN_BYTE;
+    chunk->due_us += sim_wire_us(chunk->baudrate, length);
+    if (chunk->due_us > sim->now_us) sim->now_us = chunk->due_us;
+    chunk->offset += length;
+    if (chunk->offset == chunk->length)
+        sim->chunks[next] = sim->chunks[--sim->chunk_count];
+
+    sim->rx_bytes += length;
+    if (sim->rx != NULL)
+        sim->rx(sim->rx_user, sim->now_us, burst, length);
+    return true;
+}
+
+/**
+ * @brief Moves the clock of the simulation forward, and delivers every
+ * byte which is due meanwhile in order.
+ */
+void telit_sim_advance(telit_sim_t* sim, uint64_t us) {
+    uint64_t target_us = sim->now_us + us;
+
+    while (sim_deliver_next(sim, target_us));
+
+    // A burst may end on the wire after the target, the clock never goes back.
+    if (sim->now_us < target_us) sim->now_us = target_us;
+}
+
+/**
+ * @brief Moves the clock forward until the next delivery, or the timeout.
+ * It is the simulated counterpart of sleeping until the UART interrupt.
+ */
+void telit_sim_wait(telit_sim_t* sim, uint64_t timeout_us) {
+    uint64_t target_us = sim->now_us + timeout_us;
+
+    if (!sim_deliver_next(sim, target_us))
+        sim->now_us = target_us;
+}
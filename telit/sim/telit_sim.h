@@ -0,0 +1,164 @@
+#ifndef TELIT_SIM_H
+#define TELIT_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telit_port.h"
+
+/********     SIMULATED MODEM SETTINGS    ********/
+#define TELIT_SIM_LINE_SIZE 4608
+#define TELIT_SIM_MAX_CHUNKS 64
+#define TELIT_SIM_CHUNK_SIZE 4608
+#define TELIT_SIM_MAX_RULES 16
+#define TELIT_SIM_MAX_LATENCIES 16
+#define TELIT_SIM_MAX_MESSAGES 32
+#define TELIT_SIM_MAX_SUBSCRIPTIONS 4
+#define TELIT_SIM_MQTT_INSTANCES 4     // MQTT clients of the modem, #MQEN=1 to this.
+#define TELIT_SIM_PDP_CONTEXTS 5       // Contexts "#SGACT?" answers a line for; the SDK activates 1.
+#define TELIT_SIM_TOPIC_SIZE 128
+#define TELIT_SIM_PAYLOAD_SIZE 4096
+#define TELIT_SIM_RX_BURST 64          // Bytes the UART interrupt takes at once.
+#define TELIT_SIM_TX_FIFO 32           // Bytes the board's UART holds before they are on the wire, as the Pico's.
+#define TELIT_SIM_ERROR_INTERVAL 16    // Above max_baudrate, one byte in this many is broken.
+#define TELIT_SIM_BROKEN_BYTE 0xFF     // A byte broken on the way to the board turns into this.
+/*************************************************/
+
+// It receives the bytes which the modem sends to the board, with the time they arrived.
+typedef void (*telit_sim_rx_t)(void* user, uint64_t time_us, const uint8_t* data, size_t length);
+
+// Bytes on their way to the board.
+typedef struct telit_sim_chunk {
+    uint64_t    due_us;
+    uint32_t    sequence;
+    uint16_t    length;
+    uint16_t    offset;         // Bytes delivered so far.
+    uint32_t    baudrate;       // The speed of the modem when it was sent.
+    uint8_t     data[TELIT_SIM_CHUNK_SIZE];
+} telit_sim_chunk_t;
+
+// A scripted answer. It overrides the modem model for the matching commands.
+typedef struct telit_sim_rule {
+    char        command[64];
+    char        response[256];
+    uint32_t    latency_ms;
+    uint32_t    remaining;      // 0 means the rule never expires.
+    bool        used;
+} telit_sim_rule_t;
+
+// Latency of the commands which start with the given text.
+typedef struct telit_sim_latency {
+    char        command[32];
+    uint32_t    latency_ms;
+} telit_sim_latency_t;
+
+// A message waiting in the modem to be read with #MQREAD.
+typedef struct telit_sim_message {
+    bool        used;
+    uint8_t     instance;       // The MQTT client it came to.
+    char        topic[TELIT_SIM_TOPIC_SIZE];
+    uint16_t    length;
+    uint8_t     payload[TELIT_SIM_PAYLOAD_SIZE];
+} telit_sim_message_t;
+
+// An MQTT client of the modem, e.g. "#MQCONN=2,...".
+typedef struct telit_sim_mqtt {
+    bool        enabled;
+    bool        configured;
+    bool        connected;
+    bool        last_will;
+    uint16_t    keepalive_s;        // <keepalive> of #MQCFG2=.
+    bool        clean_session;      // <clean_session> of #MQCFG2=.
+    char        broker[TELIT_SIM_TOPIC_SIZE];
+    uint16_t    port;
+    char        subscriptions[TELIT_SIM_MAX_SUBSCRIPTIONS][TELIT_SIM_TOPIC_SIZE];
+} telit_sim_mqtt_t;
+
+typedef struct telit_sim {
+    // Behaviour of the modem. They can be changed at any time.
+    uint32_t    latency_ms;         // Latency of the commands without an entry in latencies.
+    uint32_t    baudrate;           // Speed of the modem's side of the line, 0 delivers the bytes at once. +IPR= changes it.
+    uint32_t    board_baudrate;     // Speed of the board's side, 0 follows the modem. The bytes are broken if they differ.
+    uint32_t    max_baudrate;       // The fastest the wiring carries without errors, 0 for any speed.
+    uint8_t     signal_quality;     // <rssi> of +CSQ.
+    uint8_t     creg_status;        // <stat> of +CREG?.
+    uint8_t     cgreg_status;       // <stat> of +CGREG?.
+    uint8_t     cgatt_status;       // <state> of +CGATT?.
+    bool        echo;               // ATE1, the SDK relies on it.
+    bool        loopback;           // Publishes are delivered back to every subscription.
+    bool        ring;               // Downlink messages are announced with #MQRING.
+    uint32_t    boot_ms;            // The modem ignores the lines until this time of the clock, as after its power-up.
+
+    // Clock of the simulation.
+    uint64_t    now_us;
+    uint64_t    busy_until_us;
+
+    // State of the modem.
+    uint8_t     creg_mode;          // <n> of +CREG=, 1 reports the changes with URCs.
+    uint8_t     cgreg_mode;         // <n> of +CGREG=.
+    bool        apn_defined;
+    bool        pdp_active;         // Of the context 1, the others are never active.
+    telit_sim_mqtt_t    mqtt[TELIT_SIM_MQTT_INSTANCES];     // Instance 1 is mqtt[0].
+    telit_sim_message_t messages[TELIT_SIM_MAX_MESSAGES];   // The slots are shared by the instances.
+
+    // Statistics.
+    uint32_t    commands;
+    uint32_t    publishes;
+    uint32_t    reboots;
+    uint64_t    tx_bytes;           // From the board to the modem.
+    uint64_t    rx_bytes;           // From the modem to the board.
+    uint64_t    broken_bytes;       // Broken on the line, in both directions.
+    uint64_t    tx_overruns;        // Written while the TX FIFO of the board was full, they never reach the modem.
+
+    // Scripting.
+    telit_sim_rule_t    rules[TELIT_SIM_MAX_RULES];
+    telit_sim_latency_t latencies[TELIT_SIM_MAX_LATENCIES];
+
+    // Internals.
+    telit_sim_rx_t      rx;
+    void*               rx_user;
+    telit_sim_chunk_t   chunks[TELIT_SIM_MAX_CHUNKS];
+    uint8_t             chunk_count;
+    uint32_t            sequence;
+    uint64_t            line_bytes;         // Bytes on the line in both directions, for the errors.
+    uint64_t            tx_until_us;        // The TX FIFO of the board is empty from this time on.
+    char                line[TELIT_SIM_LINE_SIZE];
+    uint16_t            line_length;
+
+    // The payload of #MQPUBSBIN after its prompt.
+    uint8_t             binary_instance;
+    char                binary_topic[TELIT_SIM_TOPIC_SIZE];
+    uint8_t             binary[TELIT_SIM_PAYLOAD_SIZE];
+    uint16_t            binary_length;
+    uint16_t            binary_remaining;
+    uint64_t            binary_from_us;     // The prompt is out, the bytes before it belong to the command line.
+} telit_sim_t;
+
+void telit_sim_init(telit_sim_t* sim);
+void telit_sim_set_rx(telit_sim_t* sim, telit_sim_rx_t rx, void* user);
+
+// Scripting.
+bool telit_sim_set_latency(telit_sim_t* sim, const char* command, uint32_t latency_ms);
+bool telit_sim_script(telit_sim_t* sim, const char* command, const char* response, uint32_t latency_ms, uint32_t count);
+bool telit_sim_inject(telit_sim_t* sim, uint32_t delay_ms, const char* text);
+void telit_sim_set_registration(telit_sim_t* sim, uint8_t creg_status, uint8_t cgreg_status);
+int telit_sim_queue_message(telit_sim_t* sim, uint8_t instance, const char* topic, const uint8_t* payload, uint16_t length);
+
+// Transport.
+size_t telit_sim_tx_room(const telit_sim_t* sim);
+void telit_sim_tx_wait(telit_sim_t* sim);
+void telit_sim_write(telit_sim_t* sim, const uint8_t* data, size_t length);
+void telit_sim_advance(telit_sim_t* sim, uint64_t us);
+void telit_sim_wait(telit_sim_t* sim, uint64_t timeout_us);
+
+/**
+ * @brief Binds the selected modem of the SDK, see telit_select(), to the
+ * simulated modem. The SDK runs on the clock of the simulation, so waiting
+ * costs no real time.
+ *
+ * @param sim The simulated modem.
+ */
+void telit_sim_attach(telit_sim_t* sim);
+
+#endif
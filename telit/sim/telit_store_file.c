@@ -0,0 +1,81 @@
+#include <string.h>
+
+#include "telit_store_file.h"
+
+static bool file_read(void* user, uint32_t page, uint8_t* data) {
+    telit_store_file_t* store_file = (telit_store_file_t*) user;
+
+    if (fseek(store_file->file, (long) page * TELIT_STORE_FILE_PAGE_SIZE, SEEK_SET) != 0) return true;
+    return fread(data, 1, TELIT_STORE_FILE_PAGE_SIZE, store_file->file) != TELIT_STORE_FILE_PAGE_SIZE;
+}
+
+static bool file_write(telit_store_file_t* store_file, uint32_t page, const uint8_t* data) {
+    if (fseek(store_file->file, (long) page * TELIT_STORE_FILE_PAGE_SIZE, SEEK_SET) != 0) return true;
+    if (fwrite(data, 1, TELIT_STORE_FILE_PAGE_SIZE, store_file->file) != TELIT_STORE_FILE_PAGE_SIZE) return true;
+    return fflush(store_file->file) != 0;
+}
+
+static bool file_program(void* user, uint32_t page, const uint8_t* data) {
+    telit_store_file_t* store_file = (telit_store_file_t*) user;
+    uint8_t current[TELIT_STORE_FILE_PAGE_SIZE];
+
+    // Like NOR flash, a bit which is 0 stays 0 until the sector is erased.
+    if (file_read(user, page, current)) return true;
+    for (uint16_t i = 0; i < TELIT_STORE_FILE_PAGE_SIZE; i++)
+        current[i] &= data[i];
+
+    store_file->programs++;
+    return file_write(store_file, page, current);
+}
+
+static bool file_erase(void* user, uint32_t sector) {
+    telit_store_file_t* store_file = (telit_store_file_t*) user;
+    uint8_t blank[TELIT_STORE_FILE_PAGE_SIZE];
+    memset(blank, 0xFF, sizeof(blank));
+
+    uint32_t first_page = sector * TELIT_STORE_FILE_PAGES_PER_SECTOR;
+    for (uint32_t page = first_page; page < first_page + TELIT_STORE_FILE_PAGES_PER_SECTOR; page++)
+        if (file_write(store_file, page, blank)) return true;
+
+    store_file->erases++;
+    return false;
+}
+
+/**
+ * @brief Opens the file of the queue, or creates it erased. The content of
+ * an existing file is kept, as the flash keeps it over a reboot.
+ *
+ * @return true The file can't be opened.
+ * @return false The backend is ready.
+ */
+bool telit_store_file_open(telit_store_file_t* store_file, const char* path, uint16_t sector_count) {
+    memset(store_file, 0, sizeof(*store_file));
+    store_file->backend.page_size = TELIT_STORE_FILE_PAGE_SIZE;
+    store_file->backend.pages_per_sector = TELIT_STORE_FILE_PAGES_PER_SECTOR;
+    store_file->backend.sector_count = sector_count;
+    store_file->backend.read = file_read;
+    store_file->backend.program = file_program;
+    store_file->backend.erase = file_erase;
+    store_file->backend.user = store_file;
+
+    store_file->file = fopen(path, "r+b");
+    if (store_file->file != NULL) {
+        fseek(store_file->file, 0, SEEK_END);
+        if (ftell(store_file->file) == (long) sector_count * TELIT_STORE_FILE_PAGES_PER_SECTOR * TELIT_STORE_FILE_PAGE_SIZE)
+            return false;
+        fclose(store_file->file);
+    }
+
+    store_file->file = fopen(path, "w+b");
+    if (store_file->file == NULL) return true;
+
+    for (uint16_t sector = 0; sector < sector_count; sector++)
+        if (file_erase(store_file, sector)) return true;
+    store_file->erases = 0;
+    return false;
+}
+
+void telit_store_file_close(telit_store_file_t* store_file) {
+    if (store_file->file != NULL) fclose(store_file->file);
+    store_file->file = NULL;
+}
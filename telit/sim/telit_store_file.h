@@ -0,0 +1,27 @@
+#ifndef TELIT_STORE_FILE_H
+#define TELIT_STORE_FILE_H
+
+#include <stdio.h>
+
+#include "telit_store.h"
+
+#define TELIT_STORE_FILE_PAGE_SIZE 256
+#define TELIT_STORE_FILE_PAGES_PER_SECTOR 16
+
+/**
+ * @brief Storage of the outbound queue in a file of the host, it behaves
+ * like the flash of the board: programming only clears bits.
+ */
+typedef struct telit_store_file {
+    telit_store_backend_t   backend;
+    FILE*                   file;
+
+    // Statistics.
+    uint32_t                programs;
+    uint32_t                erases;
+} telit_store_file_t;
+
+bool telit_store_file_open(telit_store_file_t* store_file, const char* path, uint16_t sector_count);
+void telit_store_file_close(telit_store_file_t* store_file);
+
+#endif
@@ -0,0 +1,1896 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telit.h"
+#include "telit_cmd.h"
+#include "telit_ring.h"
+#include "telit_urc.h"
+
+_Static_assert((TELIT_RX_RING_SIZE & (TELIT_RX_RING_SIZE - 1)) == 0, "TELIT_RX_RING_SIZE has to be a power of two");
+
+telit_modem_t   default_modem = {                   // It holds the modem of telit_set_port(), which is selected at the start.
+    .rx_ring = {
+        .data = default_modem.rx_ring_storage,
+        .mask = TELIT_RX_RING_SIZE - 1,
+    },
+    .message_result = TELIT_RESULT_OK,
+    .command_stats = { .pending = -1 },
+};
+telit_modem_t*  modem = &default_modem;             // It holds the modem the SDK talks to, see telit_select().
+
+// The MQTT settings of the modem, one answer for every query from TELIT_QUERY_MQTT_ENABLED on.
+#define MQTT_SETTING_COUNT (TELIT_QUERY_MQTT_STATUS - TELIT_QUERY_MQTT_ENABLED + 1)
+#define MQTT_SETTING(name) (TELIT_QUERY_MQTT_##name - TELIT_QUERY_MQTT_ENABLED)
+
+typedef struct mqtt_settings {
+    telit_query_result_t    answers[MQTT_SETTING_COUNT];
+    bool                    is_read[MQTT_SETTING_COUNT];
+} mqtt_settings_t;
+
+_Static_assert(TELIT_MQTT_CLIENT_COUNT >= 1 && TELIT_MQTT_CLIENT_COUNT <= 9, "The MQTT commands keep one digit for the instance");
+_Static_assert(TELIT_MQTT_MAX_MESSAGE_ID <= 32, "The empty slots of a client are kept in 32 bits");
+
+static void telit_on_event(const telit_event_t*, void*);
+static void telit_wait_idle();
+static void telit_write(const uint8_t[], size_t);
+static void telit_write_line(const char[], uint16_t);
+static uint32_t telit_write_data(uint32_t, telit_data_source_t, void*);
+static bool telit_wait_prompt(uint32_t);
+
+// The MQTT client selected, and its instance in the modem.
+static mqtt_client_t* mqtt_client() {
+    return &modem->mqtt_clients[modem->mqtt_client];
+}
+
+static uint8_t mqtt_client_id() {
+    return modem->mqtt_client + 1;
+}
+
+/**
+ * @brief Starts an MQTT command with the instance of the selected client,
+ * e.g. "#MQPUBS=2".
+ */
+static void mqtt_cmd_begin(telit_cmd_t* cmd, char* line, uint16_t size, telit_cmd_id_t id) {
+    telit_cmd_begin(cmd, line, size, id);
+    telit_cmd_arg_uint(cmd, mqtt_client_id());
+}
+
+/**
+ * @brief Sends "#MQREAD=<instance>,<id>". Whatever the answer, the slot is
+ * empty after it: its message is taken, or there was none.
+ */
+static bool mqtt_send_read(uint8_t message_id) {
+    char line[sizeof("AT#MQREAD=1,255\r\n")];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQREAD);
+    telit_cmd_arg_uint(&cmd, message_id);
+    telit_cmd_end(&cmd);
+
+    if (message_id >= 1 && message_id <= TELIT_MQTT_MAX_MESSAGE_ID)
+        mqtt_client()->empty_slots |= 1UL << (message_id - 1);
+    return send_command_to_telit(&cmd);
+}
+
+/**
+ * @brief Asks the modem with #MQREAD? how many messages of the selected
+ * client are waiting.
+ *
+ * @param count The number of the messages, set only on success.
+ * @return true The modem didn't answer it.
+ * @return false The count is read.
+ */
+bool mqtt_new_message_count(uint16_t* count) {
+    #ifdef DETAILED_PRINT
+        printf("\n==== mqtt_new_message_count() ====\n");
+    #endif
+
+    char line[sizeof("AT#MQREAD?\r\n")];
+    telit_cmd_t cmd;
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQREAD_READ);
+    telit_cmd_end(&cmd);
+
+    if (send_command_to_telit(&cmd)) return true;
+
+    #ifdef DETAILED_PRINT
+        printf("-- message count request sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+
+    // Check if the returned message is belongs to our command.
+    const telit_event_t* info = telit_last_info();
+    if (info != NULL && telit_event_is_number(info, 1)) { 
+
+        // Save it as a variable to use it later.
+        int32_t message_count = info->fields[1];
+
+        #ifdef DETAILED_PRINT
+            printf("-- RESULT: message count %ld\n", (long) message_count);
+            printf("==== mqtt_new_message_count() ====\n\n");
+        #endif
+
+        if (result != TELIT_RESULT_OK || message_count < 0) return true;
+        *count = (message_count > UINT16_MAX) ? UINT16_MAX : message_count;
+        return false;
+    }
+    
+    #ifdef DETAILED_PRINT
+        printf("==== mqtt_new_message_count() ====\n\n");
+    #endif
+    
+    return true;
+}
+
+/**
+ * @brief Gives the message being read to the handler of mqtt_read_all().
+ * It is called from the parser, so the payload may still be in the RX ring.
+ */
+static void mqtt_deliver_view(const uint8_t* payload, uint16_t length) {
+    mqtt_message_view_t message = { .id = modem->read_message_id, .payload = payload, .length = length };
+
+    // "#MQREAD: <instance>,<topic>,<length>"
+    message.topic = telit_event_field(&modem->last_info, 1, &message.topic_length);
+    if (message.topic == NULL) message.topic = "";
+
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_READ, modem->read_message_id, length, (const char*) payload == modem->message_buffer);
+
+    modem->read_handler(&message, modem->read_handler_user);
+    modem->read_delivered++;
+}
+
+/**
+ * @brief Reads every message waiting in the modem back to back, and gives
+ * each one to the handler as it arrives. A payload which comes in one piece
+ * is given right from the RX storage, without a copy. The handler runs while
+ * the answer is parsed; it must not send a command.
+ *
+ * It counts the messages with #MQREAD?, so messages whose #MQRING is lost,
+ * e.g. while the session was down, are read too. The modem tells only the
+ * count, not the ids, so the slots are tried one by one; the ones known to
+ * be read since their last #MQRING are tried last, only if the rest don't
+ * hold them all. They are known while the client has a handler, which sees
+ * every #MQRING.
+ *
+ * @return uint8_t The number of the messages read.
+ */
+uint8_t mqtt_read_all(mqtt_view_handler_t handler, void* user) {
+    uint16_t count;
+    if (mqtt_new_message_count(&count) || count == 0) return 0;
+
+    // Every waiting message is read here, the announcements so far are done.
+    mqtt_client_t* client = mqtt_client();
+    uint32_t empty_slots = (client->message_handler != NULL) ? client->empty_slots : 0;
+    client->ring_queue_head = 0;
+    client->ring_queue_count = 0;
+    client->lost_rings = 0;
+
+    modem->read_handler = handler;
+    modem->read_handler_user = user;
+    modem->read_delivered = 0;
+
+    // The ids are the slots of the modem, the messages taken before leave gaps.
+    bool is_failed = false;
+    for (uint8_t pass = 0; pass < 2 && !is_failed && modem->read_delivered < count; pass++) {
+        for (uint16_t message_id = 1; message_id <= TELIT_MQTT_MAX_MESSAGE_ID && modem->read_delivered < count; message_id++) {
+            bool is_known_empty = (empty_slots >> (message_id - 1)) & 1;
+            if (is_known_empty != (pass == 1)) continue;
+
+            modem->read_message_id = message_id;
+            if ((is_failed = mqtt_send_read(message_id))) break;
+            telit_wait_final(5*TELIT_MSG_WAIT_MS);
+        }
+    }
+
+    modem->read_handler = NULL;
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_READ_ALL, 0, modem->read_delivered, count);
+
+    return modem->read_delivered;
+}
+
+/**
+ * @brief Reads a message of any length, and gives its payload to the sink
+ * piece by piece as it arrives, so no buffer has to hold it. The topic is
+ * in telit_last_info() while the sink runs; the sink must not send a command.
+ *
+ * @param message_id The slot of the message in the modem, e.g. of #MQRING.
+ * @return true The message can't be read, or its payload is cut.
+ * @return false The whole payload is given to the sink.
+ */
+bool mqtt_read_stream(uint8_t message_id, telit_data_sink_t sink, void* user) {
+    modem->read_total = 0;
+    modem->read_remaining = 0;
+    modem->data_sink = sink;
+    modem->data_sink_user = user;
+
+    bool is_failed = mqtt_send_read(message_id);
+    telit_result_t result = is_failed ? TELIT_RESULT_ERROR : telit_wait_final(5*TELIT_MSG_WAIT_MS);
+    modem->data_sink = NULL;
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_READ, message_id, modem->read_total - modem->read_remaining, 2);
+
+    return result != TELIT_RESULT_OK || !modem->has_last_info || modem->read_remaining > 0;
+}
+
+char* mqtt_read_in_queue() {
+    #ifdef DETAILED_PRINT
+        printf("\n====== mqtt_read_in_queue() ======\n");
+    #endif
+
+    // "#MQREAD=<instance>,1", sent to the server.
+    mqtt_send_read(1);
+
+    #ifdef DETAILED_PRINT
+        printf("-- first message request sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+
+    // Check if the returned message is belongs to our command.
+    const telit_event_t* info = telit_last_info();
+    if (info != NULL) {
+        // Check if there is a OK signal.
+        if (result != TELIT_RESULT_OK) return "ERROR";
+
+        #ifdef DETAILED_PRINT
+            printf("-- RESULT: message databits: %d\n", info->fields[2]);
+            printf("-- RESULT: message came: %s\n", modem->message_buffer);
+            printf("==== mqtt_read_in_queue() ====\n\n");
+        #endif
+
+        return modem->message_buffer;
+    }
+    
+    #ifdef DETAILED_PRINT
+        printf("==== mqtt_read_in_queue() ====\n\n");
+    #endif
+
+    return "ERROR";
+}
+
+char* mqtt_read(uint8_t order) {
+    #ifdef DETAILED_PRINT
+        printf("\n====== mqtt_read() ======\n");
+    #endif
+
+    uint8_t msg_count = 3/*mqtt_new_message_count()*/;
+
+    // printf("-- message count: %d\n", msg_count);
+
+    if (msg_count >= order) {
+
+        // "#MQREAD=<instance>,<order>", sent to the server.
+        mqtt_send_read(order);
+
+        #ifdef DETAILED_PRINT
+            printf("-- %d. message request sent to modem.\n", order);
+            // Wait until the final result code is recieved.
+            printf("-- waiting for the answer.\n");
+        #endif
+
+        telit_result_t result = telit_wait_final(5*TELIT_MSG_WAIT_MS);
+
+        // Check if the returned message is belongs to our command.
+        const telit_event_t* info = telit_last_info();
+        if (info != NULL) {
+
+            #ifdef DETAILED_PRINT
+                printf("-- RESULT: message databits: %d\n", info->fields[2]);
+                printf("-- RESULT: message came: %s\n", modem->message_buffer);
+                printf("==== mqtt_read() ====\n\n");
+            #endif
+
+            if (result != TELIT_RESULT_OK) return "ERROR";
+            else return modem->message_buffer;
+        }
+        
+        #ifdef DETAILED_PRINT
+            printf("==== mqtt_read() ====\n\n");
+        #endif
+
+        return NULL;
+
+    } else {
+        
+        // No message to read.
+        printf("$> Not enough new message.\n");
+        #ifdef DETAILED_PRINT
+            printf("==== mqtt_new_message_count() ====\n\n");
+        #endif
+        
+        return NULL;
+    }
+}
+
+/**
+ * @brief Keeps the message id of "#MQRING: <instance>,<id>,<topic>,<length>"
+ * for the client of the instance, to be read by mqtt_process_messages(),
+ * since a URC handler can't send commands. A client without a handler
+ * leaves its messages in the modem.
+ */
+static void mqtt_on_ring(const telit_event_t* event, void* user) {
+    if (!telit_event_is_number(event, 0) || !telit_event_is_number(event, 1)) return;
+    if (event->fields[0] < 1 || event->fields[0] > TELIT_MQTT_CLIENT_COUNT) return;
+
+    mqtt_client_t* client = &modem->mqtt_clients[event->fields[0] - 1];
+    if (client->message_handler == NULL) return;
+
+    // The slot is full again, even if its announcement doesn't fit in the queue.
+    if (event->fields[1] >= 1 && event->fields[1] <= TELIT_MQTT_MAX_MESSAGE_ID)
+        client->empty_slots &= ~(1UL << (event->fields[1] - 1));
+
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_RING, event->fields[1], client->ring_queue_count, client->lost_rings);
+
+    if (client->ring_queue_count == TELIT_MQTT_RING_QUEUE_SIZE) {
+        client->lost_rings++;
+        return;
+    }
+
+    client->ring_queue[(client->ring_queue_head + client->ring_queue_count) % TELIT_MQTT_RING_QUEUE_SIZE] = event->fields[1];
+    client->ring_queue_count++;
+}
+
+/**
+ * @brief Messages of the selected client are delivered to the handler as
+ * the modem announces them with #MQRING, instead of polling #MQREAD?.
+ * 
+ * @param handler Called by mqtt_process_messages() for every message. NULL stops it.
+ */
+void mqtt_set_message_handler(mqtt_message_handler_t handler, void* user) {
+    mqtt_client_t* client = mqtt_client();
+    client->message_handler = handler;
+    client->message_handler_user = user;
+
+    // Without a handler its #MQRING is not seen, the slots read so far may fill up again.
+    if (handler == NULL) client->empty_slots = 0;
+
+    // One handler of the URC takes the announcements of every client.
+    bool has_handler = false;
+    for (uint8_t i = 0; i < TELIT_MQTT_CLIENT_COUNT; i++)
+        has_handler = has_handler || modem->mqtt_clients[i].message_handler != NULL;
+
+    telit_remove_urc("#MQRING", mqtt_on_ring);
+    if (has_handler) telit_on_urc("#MQRING", mqtt_on_ring, NULL);
+}
+
+/**
+ * @brief Makes the MQTT functions talk to the client of the instance, e.g.
+ * 2 for a second broker. The commands of every client go over the same
+ * line, one after the other; the default one is 1.
+ *
+ * @param id The instance, from 1 to TELIT_MQTT_CLIENT_COUNT.
+ * @return uint8_t The instance selected before, 0 if the id is out of range.
+ */
+uint8_t mqtt_select(uint8_t id) {
+    if (id < 1 || id > TELIT_MQTT_CLIENT_COUNT) return 0;
+
+    uint8_t selected = mqtt_client_id();
+    modem->mqtt_client = id - 1;
+    return selected;
+}
+
+uint8_t mqtt_selected() {
+    return mqtt_client_id();
+}
+
+/**
+ * @brief Gives a message of mqtt_read_all() to the handler of
+ * mqtt_set_message_handler(), which takes terminated strings.
+ */
+static void mqtt_deliver_to_handler(const mqtt_message_view_t* message, void* user) {
+    char topic[TELIT_PARSER_LINE_SIZE];
+    char payload[TELIT_BUFFER_SIZE];
+    uint16_t topic_length = (message->topic_length < sizeof(topic)) ? message->topic_length : sizeof(topic) - 1;
+    uint16_t length = (message->length < sizeof(payload)) ? message->length : sizeof(payload) - 1;
+
+    memcpy(topic, message->topic, topic_length);
+    topic[topic_length] = '\0';
+    memcpy(payload, message->payload, length);
+    payload[length] = '\0';
+
+    mqtt_client()->message_handler(topic, payload, length, mqtt_client()->message_handler_user);
+}
+
+/**
+ * @brief Reads the messages announced so far, and gives them to the handler.
+ * It has to be called from the main loop; it sends nothing if no message
+ * is announced.
+ * 
+ * @return uint8_t The number of the messages delivered.
+ */
+uint8_t mqtt_process_messages() {
+    return mqtt_process_messages_max(UINT8_MAX);
+}
+
+/**
+ * @brief The messages of every client announced by #MQRING and not read
+ * yet; if some announcements are lost, at least one more.
+ */
+uint8_t mqtt_announced_messages() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TELIT_MQTT_CLIENT_COUNT; i++) {
+        const mqtt_client_t* client = &modem->mqtt_clients[i];
+        count += client->ring_queue_count + (client->lost_rings > 0 ? 1 : 0);
+    }
+    return count;
+}
+
+// The messages announced to the selected client.
+static uint8_t mqtt_process_client_messages(uint8_t max_messages) {
+    mqtt_client_t* client = mqtt_client();
+    uint8_t delivered = 0;
+
+    while (client->ring_queue_count > 0 && delivered < max_messages) {
+        uint8_t message_id = client->ring_queue[client->ring_queue_head];
+        client->ring_queue_head = (client->ring_queue_head + 1) % TELIT_MQTT_RING_QUEUE_SIZE;
+        client->ring_queue_count--;
+
+        mqtt_send_read(message_id);
+
+        telit_result_t result = telit_wait_final(5*TELIT_MSG_WAIT_MS);
+
+        // "#MQREAD: <instance>,<topic>,<length>", the payload is in the message buffer.
+        const telit_event_t* info = telit_last_info();
+        if (result != TELIT_RESULT_OK || info == NULL) continue;
+
+        uint16_t topic_length;
+        const char* topic_field = telit_event_field(info, 1, &topic_length);
+        char topic[TELIT_PARSER_LINE_SIZE] = "";
+        if (topic_field != NULL) {
+            memcpy(topic, topic_field, topic_length);
+            topic[topic_length] = '\0';
+        }
+
+        TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_READ, message_id, modem->message_buffer_index, 1);
+
+        if (client->message_handler != NULL)
+            client->message_handler(topic, modem->message_buffer, modem->message_buffer_index, client->message_handler_user);
+        delivered++;
+    }
+
+    // Some announcements didn't fit in the queue, every waiting message is read.
+    if (client->lost_rings > 0 && client->message_handler != NULL && client->ring_queue_count == 0 && delivered < max_messages)
+        delivered += mqtt_read_all(mqtt_deliver_to_handler, NULL);
+
+    return delivered;
+}
+
+/**
+ * @brief Same as mqtt_process_messages(), but it reads at most the given
+ * number of messages; the rest stay in the modem for the next call, e.g.
+ * while the handler has no room for them.
+ *
+ * @return uint8_t The number of the messages delivered.
+ */
+uint8_t mqtt_process_messages_max(uint8_t max_messages) {
+    uint8_t delivered = 0;
+
+    telit_process_rx();
+
+    // Every client in turn, each with its own handler.
+    uint8_t selected = mqtt_selected();
+    for (uint8_t id = 1; id <= TELIT_MQTT_CLIENT_COUNT && delivered < max_messages; id++) {
+        mqtt_select(id);
+        delivered += mqtt_process_client_messages(max_messages - delivered);
+    }
+    mqtt_select(selected);
+
+    return delivered;
+}
+
+bool mqtt_logout() {
+    #ifdef DETAILED_PRINT
+        // Inform the function entrance.
+        printf("\n======= mqtt_logout() =======\n");
+    #endif
+
+    // "#MQDISC=<instance>"
+    char line[sizeof("AT#MQDISC=1\r\n")];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQDISC);
+    telit_cmd_end(&cmd);
+    send_command_to_telit(&cmd);
+
+    #ifdef DETAILED_PRINT
+        printf("-- logout message sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+
+    // If there is no OK, then something got wrong.
+    if (result != TELIT_RESULT_OK) {
+        #ifdef DETAILED_PRINT
+            printf("======= mqtt_logout() =======\n\n");
+        #endif
+
+        return true;
+    }
+
+    #ifdef DETAILED_PRINT
+        printf("-- RESULT: mqtt logged out is performed\n");
+        printf("======= mqtt_logout() =======\n\n");
+    #endif
+
+    return false;
+}
+
+bool process_mqtt_enable(bool will, char server_address[], char server_port[]) {
+    printf("$> MQTT is enabling, and setting up...\n");
+
+    // Try 3 times to enable, and set the MQTT.
+    for (int try = 0; try < 3; try++) {
+        if (!mqtt_enable_and_configure(will, server_address, server_port)) {
+            printf("$> MQTT is enabled and setted.\n");
+            return false;
+        } else {
+            printf("$> MQTT is failed to enable.\n");
+            // If it couldn't achieve on the tryings, reboot Pico.
+            if (try == 2) {
+                printf("$> MQTT enabling couldn't completed.\n");
+                printf("$> Pico will be reboot in 3 seconds.\n");
+                // Let the Pico to sleep for 3 seconds to show the information to user.
+                telit_sleep_ms(3000);
+                // Reboot the Pico.
+                telit_reboot();
+            }
+
+            telit_sleep_ms(TELIT_MSG_WAIT_MS);
+        }
+    }
+
+    return true;
+}
+
+bool process_mqtt_login(char client_id[], char user_name[], char password[]){
+    uint8_t status_code = 0;
+
+    // Try to connect for 3 times.
+    for (uint8_t try = 0; try < 3; try++) {
+        // Inform the user.
+        printf("$> Logging into the MQTT broker... (%d)\n", try + 1);
+        
+        // Get the status code.
+        status_code = mqtt_login(client_id, user_name, password);
+        
+        // If it is not 1, it is not connected.
+        if (status_code == 1) {
+            printf("$> Logged in to the MQTT broker.\n");
+            break;
+
+        } else {
+            printf("$> Failed to login to the MQTT broker, trying again.\n");
+            mqtt_logout();
+
+            if (try == 2) {
+                printf("$> MQTT login couldn't completed.\n");
+                printf("$> Pico will be reboot in 3 seconds.\n");
+                // Let the Pico to sleep for 3 seconds to show the information to user.
+                telit_sleep_ms(3000);
+                // Reboot the Pico.
+                telit_reboot();
+            }
+
+        }
+    }
+
+    return status_code != 1;
+}
+
+/**
+ * @brief Takes an answer of the line of mqtt_read_settings().
+ *
+ * @return true It is one of the MQTT settings.
+ */
+static bool mqtt_collect_setting(const telit_event_t* event, void* user) {
+    mqtt_settings_t* settings = (mqtt_settings_t*) user;
+
+    for (uint8_t i = 0; i < MQTT_SETTING_COUNT; i++) {
+        telit_query_id_t id = TELIT_QUERY_MQTT_ENABLED + i;
+        if (!telit_event_is(event, telit_queries[id].tag)) continue;
+
+        settings->is_read[i] = !telit_query_decode(id, TELIT_RESULT_OK, event, &settings->answers[i]);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Reads every MQTT setting of the modem with one command line,
+ * "#MQEN?;#MQWCFG?;#MQCFG?;#MQCFG2?;#MQCONN?", instead of one round trip
+ * each.
+ *
+ * @return true The line failed; what was answered before is kept.
+ * @return false The settings are read.
+ */
+static bool mqtt_read_settings(mqtt_settings_t* settings) {
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+
+    memset(settings, 0, sizeof(*settings));
+    telit_cmd_begin(&cmd, line, sizeof(line), telit_queries[TELIT_QUERY_MQTT_ENABLED].command);
+    for (uint8_t i = 1; i < MQTT_SETTING_COUNT; i++) {
+        telit_cmd_append(&cmd, ";");
+        telit_cmd_append(&cmd, telit_cmd_prefixes[telit_queries[TELIT_QUERY_MQTT_ENABLED + i].command].text);
+    }
+    telit_cmd_end(&cmd);
+
+    if (send_command_to_telit(&cmd)) return true;
+
+    // Every answer but the last one would be lost in last_info.
+    modem->info_collector = mqtt_collect_setting;
+    modem->info_collector_user = settings;
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+    modem->info_collector = NULL;
+
+    return result != TELIT_RESULT_OK;
+}
+
+// It sends a setting and waits for its answer.
+static bool mqtt_write_setting(const telit_cmd_t* cmd) {
+    return send_command_to_telit(cmd) || telit_wait_final(TELIT_MSG_WAIT_MS) != TELIT_RESULT_OK;
+}
+
+/**
+ * @brief Compares the settings read with the ones wanted: is_set[] of
+ * MQTT_SETTING(ENABLED) to MQTT_SETTING(SESSION) tells if the setting is
+ * as given, and the one of MQTT_SETTING(STATUS) if the session is connected.
+ * A setting which couldn't be read is not set.
+ */
+static void mqtt_compare_settings(const mqtt_settings_t* settings, const mqtt_config_t* config, bool is_set[MQTT_SETTING_COUNT]) {
+    const telit_query_result_t* answers = settings->answers;
+
+    is_set[MQTT_SETTING(ENABLED)] = answers[MQTT_SETTING(ENABLED)].numbers[1] == 1;
+    is_set[MQTT_SETTING(WILL)] = answers[MQTT_SETTING(WILL)].numbers[1] == config->last_will;
+    is_set[MQTT_SETTING(CONFIG)] = strcmp(answers[MQTT_SETTING(CONFIG)].text, config->broker) == 0
+        && answers[MQTT_SETTING(CONFIG)].numbers[2] == config->port;
+    is_set[MQTT_SETTING(SESSION)] = answers[MQTT_SETTING(SESSION)].numbers[1] == config->keepalive_s
+        && answers[MQTT_SETTING(SESSION)].numbers[2] == config->clean_session;
+    is_set[MQTT_SETTING(STATUS)] = answers[MQTT_SETTING(STATUS)].numbers[1] == 1;
+
+    for (uint8_t i = 0; i < MQTT_SETTING_COUNT; i++)
+        is_set[i] = is_set[i] && settings->is_read[i];
+}
+
+// The settings of mqtt_enable_and_configure(), with the session of TELIT_MQTT_KEEPALIVE_S and TELIT_MQTT_CLEAN_SESSION.
+static mqtt_config_t mqtt_default_config(bool last_will, char server_address[], char server_port[]) {
+    mqtt_config_t config = {
+        .broker = server_address,
+        .port = atoi(server_port),
+        .last_will = last_will,
+        .keepalive_s = TELIT_MQTT_KEEPALIVE_S,
+        .clean_session = TELIT_MQTT_CLEAN_SESSION,
+    };
+    return config;
+}
+
+/**
+ * @brief Sets the MQTT of the modem up as given. The settings are read
+ * first with one command line, and only the ones which differ are written;
+ * the modem keeps them over a reboot of the board, so usually none is.
+ * A session which is connected with other settings is logged out first.
+ *
+ * @return true A setting couldn't be read or written.
+ * @return false The modem is set up as given.
+ */
+bool mqtt_configure(const mqtt_config_t* config) {
+    #ifdef DETAILED_PRINT
+        printf("\n==== mqtt_configure() ====\n");
+    #endif
+
+    mqtt_settings_t settings;
+    bool is_set[MQTT_SETTING_COUNT];
+    mqtt_read_settings(&settings);
+    mqtt_compare_settings(&settings, config, is_set);
+
+    bool is_enabled = is_set[MQTT_SETTING(ENABLED)];
+    bool is_will_set = is_set[MQTT_SETTING(WILL)];
+    bool is_broker_set = is_set[MQTT_SETTING(CONFIG)];
+    bool is_session_set = is_set[MQTT_SETTING(SESSION)];
+    bool is_connected = is_set[MQTT_SETTING(STATUS)];
+
+    #ifdef DETAILED_PRINT
+        printf("-- RESULT: enable %s, last will %s, broker %s, session %s\n", is_enabled ? "kept" : "written",
+               is_will_set ? "kept" : "written", is_broker_set ? "kept" : "written", is_session_set ? "kept" : "written");
+    #endif
+
+    if (is_enabled && is_will_set && is_broker_set && is_session_set) return false;
+
+    // The modem doesn't take the settings of a live session.
+    if (is_connected) mqtt_logout();
+
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+
+    // "#MQEN=<instance>,1"
+    if (!is_enabled) {
+        mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQEN);
+        telit_cmd_arg_uint(&cmd, 1);
+        telit_cmd_end(&cmd);
+        if (mqtt_write_setting(&cmd)) return true;
+    }
+
+    // "#MQWCFG=<instance>,<will>"
+    if (!is_will_set) {
+        mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQWCFG);
+        telit_cmd_arg_uint(&cmd, config->last_will ? 1 : 0);
+        telit_cmd_end(&cmd);
+        if (mqtt_write_setting(&cmd)) return true;
+    }
+
+    // "#MQCFG=<instance>,<host>,<port>,1"
+    if (!is_broker_set) {
+        mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQCFG);
+        telit_cmd_arg(&cmd, config->broker);
+        telit_cmd_arg_uint(&cmd, config->port);
+        telit_cmd_arg_uint(&cmd, 1);
+        telit_cmd_end(&cmd);
+        if (mqtt_write_setting(&cmd)) return true;
+    }
+
+    // "#MQCFG2=<instance>,<keepalive>,<clean session>"
+    if (!is_session_set) {
+        mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQCFG2);
+        telit_cmd_arg_uint(&cmd, config->keepalive_s);
+        telit_cmd_arg_uint(&cmd, config->clean_session ? 1 : 0);
+        telit_cmd_end(&cmd);
+        if (mqtt_write_setting(&cmd)) return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Enables MQTT and sets the broker and the last will up, with the
+ * session of TELIT_MQTT_KEEPALIVE_S and TELIT_MQTT_CLEAN_SESSION; see
+ * mqtt_configure().
+ */
+bool mqtt_enable_and_configure(bool last_will, char server_address[], char server_port[]) {
+    mqtt_config_t config = mqtt_default_config(last_will, server_address, server_port);
+    return mqtt_configure(&config);
+}
+
+uint8_t mqtt_login(char client_id[], char user_name[], char password[]) {
+    #ifdef DETAILED_PRINT
+        printf("\n======= mqtt_login() =======\n");
+    #endif
+
+    /********************* SENDING USER INFO **********************/
+    // "#MQCONN=<instance>,<client id>,<user name>,<password>"
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQCONN);
+    telit_cmd_arg(&cmd, client_id);
+    telit_cmd_arg(&cmd, user_name);
+    telit_cmd_arg(&cmd, password);
+    telit_cmd_end(&cmd);
+
+    // Send it to TELIT.
+    if (send_command_to_telit(&cmd)) return 60;
+
+    #ifdef DETAILED_PRINT
+        printf("-- login details sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_wait_final(TELIT_MSG_WAIT_MS * 2);
+    
+    /********************* SENDING CONFIRM **********************/
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQCONN_READ);
+    telit_cmd_end(&cmd);
+    if (send_command_to_telit(&cmd)) return 60;
+
+    #ifdef DETAILED_PRINT
+        printf("-- confirmation request sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+
+    // Check if the returned message is belongs to our command.
+    const telit_event_t* info = telit_last_info();
+    if (info != NULL && telit_event_is_number(info, 1)) { 
+
+        // Check if there is a OK signal.
+        if (result != TELIT_RESULT_OK) return 60;
+        
+        // Save it as a variable to use it later.
+        uint8_t status_code = info->fields[1];
+
+        #ifdef DETAILED_PRINT
+            printf("-- RESULT: status code %d\n", status_code);
+            printf("======= mqtt_login() =======\n\n");
+        #endif
+
+        return status_code;
+    }
+    
+    #ifdef DETAILED_PRINT
+        printf("======= mqtt_login() =======\n\n");
+    #endif
+    
+    return 60; // 60 is the error code.
+}
+
+/**
+ * @brief Asks the modem the state of the MQTT session.
+ *
+ * @return uint8_t The status of "#MQCONN?", 1 is connected. 60 on error.
+ */
+uint8_t mqtt_connection_status() {
+    telit_query_result_t answer;
+    if (telit_query(TELIT_QUERY_MQTT_STATUS, NULL, &answer))
+        return 60; // 60 is the error code.
+
+    return answer.numbers[1];
+}
+
+/**
+ * @brief Asks the modem how far its MQTT session is set up, with one
+ * command line. The modem keeps it over a reboot of the board, so the
+ * steps which are done can be skipped: process_mqtt_enable() for
+ * MQTT_SESSION_NONE only, and process_mqtt_login() unless it is
+ * MQTT_SESSION_CONNECTED.
+ *
+ * The session counts as configured when every setting of
+ * mqtt_enable_and_configure() is as given; else a live session is logged
+ * out, to be set up again.
+ *
+ * @param last_will The last will the session is set up with.
+ */
+mqtt_session_t mqtt_session_state(bool last_will, char server_address[], char server_port[]) {
+    mqtt_config_t config = mqtt_default_config(last_will, server_address, server_port);
+    mqtt_settings_t settings;
+    bool is_set[MQTT_SETTING_COUNT];
+    mqtt_read_settings(&settings);
+    mqtt_compare_settings(&settings, &config, is_set);
+
+    // The same settings as mqtt_configure() writes, the last will too.
+    bool is_configured = is_set[MQTT_SETTING(ENABLED)] && is_set[MQTT_SETTING(WILL)]
+        && is_set[MQTT_SETTING(CONFIG)] && is_set[MQTT_SETTING(SESSION)];
+    bool is_connected = is_set[MQTT_SETTING(STATUS)];
+
+    #ifdef DETAILED_PRINT
+        printf("\n==== mqtt_session_state() ====\n");
+        printf("-- RESULT: %s, %s\n", is_configured ? "configured" : "not configured", is_connected ? "connected" : "not connected");
+    #endif
+
+    if (is_connected && !is_configured) mqtt_logout();
+
+    if (!is_configured) return MQTT_SESSION_NONE;
+    return is_connected ? MQTT_SESSION_CONNECTED : MQTT_SESSION_CONFIGURED;
+}
+
+bool mqtt_subscribe_topic(char topic_subscribe_address[]) {
+    #ifdef DETAILED_PRINT
+        printf("\n==== mqtt_subscribe_topic() ====\n");
+    #endif
+
+    // "#MQSUB=<instance>,<topic>"
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQSUB);
+    telit_cmd_arg(&cmd, topic_subscribe_address);
+    telit_cmd_end(&cmd);
+
+    // Send it to TELIT.
+    if (send_command_to_telit(&cmd)) return true;
+
+    #ifdef DETAILED_PRINT
+        printf("-- subscription request sent to modem.\n");
+        // Wait until the final result code is recieved.
+        printf("-- waiting for the answer.\n");
+    #endif
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+
+    #ifdef DETAILED_PRINT
+        printf("-- RESULT:  %s\n", (result == TELIT_RESULT_OK) ? "subscribed" : "error");
+        printf("==== mqtt_subscribe_topic() ====\n\n");
+    #endif
+    
+    if (result != TELIT_RESULT_OK) return true;
+    else return false;
+}
+
+bool mqtt_publish(char topic_publish_address[], char string_to_publish[]) {
+    // "#MQPUBS=<instance>,<topic>,<retain>,<qos>,<message>"
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBS);
+    telit_cmd_arg(&cmd, topic_publish_address);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg(&cmd, string_to_publish);
+    telit_cmd_end(&cmd);
+
+    // Send it to TELIT.
+    if (send_command_to_telit(&cmd)) return true;
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_PUBLISH, 0, strlen(string_to_publish), result);
+
+    if (result != TELIT_RESULT_OK) return true;
+    else return false;
+}
+
+/**
+ * @brief Publishes a payload of any length inline, taking it from the
+ * source TELIT_STREAM_CHUNK_SIZE bytes at a time, so no buffer has to hold
+ * the whole line. The payload can't have CR or LF in it, and the modem's
+ * limit of the command line still applies. The pieces follow the command
+ * at once; the port's write waits for the line, nothing waits here.
+ *
+ * @param length The length of the payload.
+ * @param source Called for every piece; giving less than asked ends the
+ * line early.
+ * @return true The publish failed, or the source ran dry.
+ * @return false The message is sent.
+ */
+bool mqtt_publish_stream(char topic_publish_address[], uint32_t length, telit_data_source_t source, void* user) {
+    // "#MQPUBS=<instance>,<topic>,<retain>,<qos>," and the payload follows.
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBS);
+    telit_cmd_arg(&cmd, topic_publish_address);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_append(&cmd, ",");
+    if (cmd.is_overflow) return true;
+    line[cmd.length] = '\0';
+
+    telit_wait_idle();
+    telit_write_line(cmd.buffer, cmd.length);
+
+    uint32_t offset = telit_write_data(length, source, user);
+    telit_write((const uint8_t*) "\r\n", 2);
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_PUBLISH, 1, offset, result);
+
+    return result != TELIT_RESULT_OK || offset < length;
+}
+
+// The source of mqtt_publish_binary(), the payload is in memory.
+typedef struct publish_memory {
+    const uint8_t*  payload;
+    uint32_t        length;
+} publish_memory_t;
+
+static uint16_t publish_memory_source(uint8_t* buffer, uint16_t size, uint32_t offset, void* user) {
+    const publish_memory_t* memory = (const publish_memory_t*) user;
+    memcpy(buffer, memory->payload + offset, size);
+    return size;
+}
+
+/**
+ * @brief Publishes raw bytes with #MQPUBSBIN: the length goes in the
+ * command, the modem prompts with "> ", then exactly that many bytes
+ * follow as they are. Nothing is escaped, so commas, quotes, CR and binary
+ * data can be sent, and the length is not bound by the command line.
+ *
+ * @param length The length of the payload.
+ * @param source Called for every piece. If it gives less than asked, the
+ * rest is sent as zeros, since the modem waits for every byte.
+ * @return true The modem didn't prompt, the publish failed, or the source ran dry.
+ * @return false The message is sent.
+ */
+bool mqtt_publish_binary_stream(char topic_publish_address[], uint32_t length, telit_data_source_t source, void* user) {
+    // "#MQPUBSBIN=<instance>,<topic>,<retain>,<qos>,<length>"
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+    mqtt_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_MQPUBSBIN);
+    telit_cmd_arg(&cmd, topic_publish_address);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, 0);
+    telit_cmd_arg_uint(&cmd, length);
+    telit_cmd_end(&cmd);
+
+    if (send_command_to_telit(&cmd)) return true;
+
+    // The modem answers with ERROR instead of the prompt, e.g. if it is not connected.
+    if (telit_wait_prompt(TELIT_MSG_WAIT_MS)) {
+        TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_PUBLISH, 2, 0, TELIT_RESULT_ERROR);
+        return true;
+    }
+
+    uint32_t offset = telit_write_data(length, source, user);
+
+    // Fill what's missing, or the modem takes the next command as the payload.
+    uint8_t zeros[TELIT_STREAM_CHUNK_SIZE] = { 0 };
+    for (uint32_t filled = offset; filled < length; ) {
+        uint16_t size = (length - filled < sizeof(zeros)) ? length - filled : sizeof(zeros);
+        telit_write(zeros, size);
+        filled += size;
+    }
+
+    telit_result_t result = telit_wait_final(TELIT_MSG_WAIT_MS);
+    TELIT_TRACE(MQTT, TELIT_TRACE_MQTT_PUBLISH, 2, offset, result);
+
+    return result != TELIT_RESULT_OK || offset < length;
+}
+
+/**
+ * @brief Publishes the bytes with #MQPUBSBIN, see mqtt_publish_binary_stream().
+ *
+ * @return true The publish failed.
+ * @return false The message is sent.
+ */
+bool mqtt_publish_binary(char topic_publish_address[], const uint8_t payload[], uint32_t length) {
+    publish_memory_t memory = { .payload = payload, .length = length };
+    return mqtt_publish_binary_stream(topic_publish_address, length, publish_memory_source, &memory);
+}
+
+/**
+ * @brief Probes the modem with "AT" until it answers OK, instead of waiting
+ * a fixed time after its power-up. The first command can go as soon as it
+ * returns, so the boot takes as long as the modem, not a constant.
+ *
+ * @param timeout_ms The longest time to wait for the modem.
+ * @return true The modem didn't answer in time.
+ * @return false The modem is ready.
+ */
+bool telit_wait_ready(uint32_t timeout_ms) {
+    uint64_t started_us = telit_now_us();
+    uint64_t deadline_us = started_us + (uint64_t) timeout_ms * 1000;
+    uint32_t probes = 0;
+    char command[] = "";
+    bool is_ready = false;
+
+    do {
+        uint64_t next_us = telit_now_us() + TELIT_READY_PROBE_MS * 1000;
+        send_message_to_telit(command);
+        probes++;
+
+        if (telit_wait_final(TELIT_READY_PROBE_MS) == TELIT_RESULT_OK) {
+            is_ready = true;
+            break;
+        }
+
+        // An early ERROR, or noise of the power-up, is not probed again at once.
+        uint64_t now_us = telit_now_us();
+        if (now_us < next_us)
+            modem->port.sleep_ms(modem->port.user, (next_us - now_us + 999) / 1000);
+    } while (telit_now_us() < deadline_us);
+
+    uint32_t waited_ms = (telit_now_us() - started_us) / 1000;
+    TELIT_TRACE(ATTACH, TELIT_TRACE_ATTACH_READY, is_ready, probes, waited_ms);
+
+    #ifdef DETAILED_PRINT
+        printf("\n==== telit_wait_ready() ====\n");
+        printf("-- RESULT: %s after %lu probes, %lu ms\n", is_ready ? "ready" : "silent", (unsigned long) probes, (unsigned long) waited_ms);
+    #endif
+
+    return !is_ready;
+}
+
+/**
+ * @brief Turns the RTS/CTS flow control of the modem on or off, "&K3" or
+ * "&K0". The board's side is set up by the port, e.g. with
+ * TELIT_UART_FLOW_CONTROL of the Pico.
+ *
+ * @return true The modem refused it.
+ */
+bool telit_set_flow_control(bool is_on) {
+    char command[] = "&K0";
+    if (is_on) command[2] = '3';
+
+    send_message_to_telit(command);
+    return telit_wait_final(TELIT_MSG_WAIT_MS) != TELIT_RESULT_OK;
+}
+
+static bool telit_set_port_baudrate(uint32_t baudrate) {
+    return modem->port.set_baudrate == NULL || modem->port.set_baudrate(modem->port.user, baudrate);
+}
+
+/**
+ * @brief Test of the line at its speed: the command has to be answered
+ * OK, the given times in a row, and its echo has to come back as it is if
+ * one comes.
+ *
+ * @param command The probe after "AT"; it must not change the modem, e.g.
+ * "" or the echo setting it already has.
+ */
+static bool telit_verify_line(uint8_t probes, char command[]) {
+    for (uint8_t i = 0; i < probes; i++) {
+        send_message_to_telit(command);
+        if (telit_wait_final(TELIT_READY_PROBE_MS) != TELIT_RESULT_OK
+            || (modem->last_echo[0] != '\0' && strcmp(modem->last_echo + 2, command) != 0))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Asks the modem for the speed with "+IPR=", at the speed of now.
+ * Its OK still comes at the old speed, then the board's side follows.
+ */
+static bool telit_switch_baudrate(uint32_t baudrate) {
+    char line[TELIT_COMMAND_SIZE];
+    telit_cmd_t cmd;
+    telit_cmd_begin(&cmd, line, sizeof(line), TELIT_CMD_IPR);
+    telit_cmd_append_uint(&cmd, baudrate);
+    telit_cmd_end(&cmd);
+
+    if (send_command_to_telit(&cmd) || telit_wait_final(TELIT_BAUD_SWITCH_MS) != TELIT_RESULT_OK)
+        return true;
+
+    return telit_set_port_baudrate(baudrate);
+}
+
+/**
+ * @brief Finds the speed the modem runs at by probing every given one,
+ * e.g. after a reboot of the board which the modem didn't see. If none
+ * answers, the board is left at the first one.
+ *
+ * @return uint32_t The speed of the modem, 0 if it doesn't answer.
+ */
+uint32_t telit_find_baudrate(const uint32_t baudrates[], uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (telit_set_port_baudrate(baudrates[i])) continue;
+        if (!telit_verify_line(1, "")) return baudrates[i];
+    }
+
+    if (count > 0) telit_set_port_baudrate(baudrates[0]);
+    return 0;
+}
+
+/**
+ * @brief Steps the line up through the given speeds, slowest first, as far
+ * as the modem and the board carry it. Every speed is asked for with
+ * "+IPR=" and has to pass TELIT_BAUD_VERIFY_PROBES echo tests; at the
+ * first one which fails, the line goes back to the speed before it.
+ *
+ * @param baudrate The speed of the line now.
+ * @return uint32_t The speed of the line, 0 if the modem is lost.
+ */
+uint32_t telit_negotiate_baudrate(const uint32_t baudrates[], uint8_t count, uint32_t baudrate) {
+    if (modem->port.set_baudrate == NULL) return baudrate;
+
+    // The echo test asks for the echo the modem has, at the clean speed of now, so it is kept.
+    char probe[] = "E1";
+    if (modem->is_echo_off) probe[1] = '0';
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (baudrates[i] <= baudrate) continue;
+
+        bool is_passed = !telit_switch_baudrate(baudrates[i]) && !telit_verify_line(TELIT_BAUD_VERIFY_PROBES, probe);
+        TELIT_TRACE(AT, TELIT_TRACE_BAUDRATE, is_passed, baudrates[i], 0);
+
+        #ifdef DETAILED_PRINT
+            printf("\n==== telit_negotiate_baudrate() ====\n");
+            printf("-- RESULT: %lu baud %s\n", (unsigned long) baudrates[i], is_passed ? "passed" : "failed");
+        #endif
+
+        if (is_passed) {
+            baudrate = baudrates[i];
+            continue;
+        }
+
+        // The modem is at the new speed if its "+IPR=" got through, else still at the old one.
+        uint32_t sides[2] = { baudrates[i], baudrate };
+        for (uint8_t try = 0; try < TELIT_BAUD_FALLBACK_TRIES; try++) {
+            for (uint8_t side = 0; side < 2; side++) {
+                if (!telit_set_port_baudrate(sides[side]) && !telit_switch_baudrate(baudrate)
+                    && !telit_verify_line(TELIT_BAUD_VERIFY_PROBES, probe))
+                    return baudrate;
+            }
+        }
+        return 0;
+    }
+
+    return baudrate;
+}
+
+/**
+ * @brief Prints the progress of the network bring-up.
+ */
+static void telit_init_3g_progress(const telit_attach_t* attach, telit_attach_event_t event, void* user) {
+    const char* name = telit_attach_state_name(attach->state);
+
+    if (event == TELIT_ATTACH_ENTERED && attach->state == TELIT_ATTACH_READY)
+        printf("$> Connected in %u ms, IP: %s\n", telit_attach_elapsed_ms(attach), attach->ip_address);
+    else if (event == TELIT_ATTACH_ENTERED)
+        printf("$> Checking %s...\n", name);
+    else if (event == TELIT_ATTACH_RETRY)
+        printf("$> Checking %s failed, trying again in %u ms. (%d)\n", name, attach->delay_ms, attach->attempt);
+    else
+        printf("$> Checking %s failed %d times, going back.\n", name, attach->attempt);
+}
+
+/**
+ * @brief The function checks and sets everything, and connect the TELIT into 3G network.
+ * It runs the bring-up until it is connected; a failing step goes back to an earlier
+ * one with a growing backoff, instead of rebooting. Use telit_attach_step() from the
+ * main loop to keep the application running meanwhile.
+ */
+void telit_init_3g() {
+    telit_attach_init(&modem->network_attach, "super", telit_init_3g_progress, NULL);
+    telit_attach_start(&modem->network_attach);
+
+    while (telit_attach_step(&modem->network_attach) != TELIT_ATTACH_READY) {
+        modem->port.wait_ms(modem->port.user, 1);
+        telit_poll();
+    }
+}
+
+/**
+ * @brief This function activates Packet Domain Protocol. Returns "false" if it is activated.
+ * 
+ * @return true: PDP is not activated.
+ * @return false PDP is activated.
+ */
+bool activate_pdp() {
+    telit_query_result_t answer;
+    if (telit_query(TELIT_QUERY_PDP_ACTIVATE, NULL, &answer)) return true;
+
+    // Travel inside the IP address, and give the numbers into ip_address.
+    uint8_t index_of_number = 0;
+    memset(modem->ip_address, 0, sizeof(modem->ip_address));
+    for (const char* c = answer.text; *c != '\0' && index_of_number < 4; c++) {
+        // Check if the current character is a delimeter.
+        if (*c == '.')
+            index_of_number++;
+        else if (*c >= '0' && *c <= '9')
+            modem->ip_address[index_of_number] = modem->ip_address[index_of_number] * 10 + (*c - '0');
+    }
+
+    return false;
+}
+
+/**
+ * @brief It defines APN details. If everything works correctly, it returns false.
+ * 
+ * @return true APN is not setted.
+ * @return false APN is setted.
+ */
+bool define_apn() {
+    /* TODO: Let user to change "super" in future. */
+    telit_query_result_t answer;
+    return telit_query(TELIT_QUERY_APN, "super", &answer);
+}
+
+/**
+ * @brief This function checks for GPRS with CGREG command. It returns the status.
+ * 
+ * @return uint8_t 
+ */
+uint8_t check_gprs_registration() {
+    // The answer looks like "+CGREG: 0,5".
+    telit_query_result_t answer;
+    if (telit_query(TELIT_QUERY_GPRS, NULL, &answer)) return 0;
+
+    return answer.numbers[1];
+}
+
+/**
+ * @brief Lets the modem report the changes of the carrier and GPRS
+ * registration with "+CREG: <stat>" and "+CGREG: <stat>" URCs, so they
+ * don't have to be polled.
+ * 
+ * @return true The reports couldn't enabled.
+ * @return false The reports are enabled.
+ */
+bool enable_registration_reports() {
+    #ifdef DETAILED_PRINT
+        printf("\n==== enable_registration_reports() ====\n");
+    #endif
+
+    send_message_to_telit("+CREG=1");
+    if (telit_wait_final(TELIT_MSG_WAIT_MS) != TELIT_RESULT_OK) return true;
+
+    send_message_to_telit("+CGREG=1");
+    if (telit_wait_final(TELIT_MSG_WAIT_MS) != TELIT_RESULT_OK) return true;
+
+    return false;
+}
+
+/**
+ * @brief This function runs GPRS registration 20 times, and waits for return 2.
+ * If it returns 2, everything is correct.
+ */
+void process_gprs_registration() {
+    uint8_t is_gr_set;
+
+    // Try to get GPRS registration for 20 times.
+    for (int try = 0; try < 20; try++) {
+        printf("$> Checking GPRS registration... (%d)\n", try+1);
+        is_gr_set = check_gprs_registration();
+        // If it is good, exit from the loop.
+        if (is_gr_set == 0 || is_gr_set == 1 || is_gr_set == 5) break;
+        else if (is_gr_set == 2) {
+            printf("$> Waiting for 5 second.\n");
+            telit_sleep_ms(5000);
+        }
+        else if (is_gr_set == 3) {
+            printf("$> ERROR: Return [3]. Not Implemented.\n");
+            printf("$> GRPS registration check not completed.\n");
+            return;
+        }
+    }
+
+    printf("$> GRPS registration check completed.\n");
+}
+
+/**
+ * @brief It checks for GPRS attachment with CGATT. Returns false if status is 1.
+ * 
+ * @return true It has problems.
+ * @return false Everything is okay.
+ */
+bool check_gprs_attach() {
+    // Return false if everything is okay.
+    telit_query_result_t answer;
+    return telit_query(TELIT_QUERY_GPRS_ATTACH, NULL, &answer) || answer.numbers[0] != 1;
+}
+
+/**
+ * @brief It does the automation of GPRS attachemnt check.
+ * 
+ */
+void process_gprs_attach() {
+    uint8_t is_ga_set;
+
+    printf("$> Checking GPRS attach...\n");
+    is_ga_set = !check_gprs_attach();
+    if (is_ga_set) {
+        printf("$> GPRS attach check completed.\n");
+    }
+    else {
+        printf("$> ERROR: Not Implemented.\n");
+        printf("$> GPRS attach check not completed.\n");
+    }
+}
+
+/**
+ * @brief It does the automation of the carrier registration. 
+ * It tries only 3 times, which is different from the documentation.
+ * If it couldn't registered to the carrier, reboots the system.
+ * 
+ */
+void process_carrier_registration() {
+    uint8_t is_cr_set;
+
+    // Try to get signal quality for 3 times, if it is bad, reboot it.
+    for (int try = 0; try < 3; try++) {
+        printf("$> Checking carrier registration... (%d)\n", try+1);
+        is_cr_set = check_carrier_registration();
+        // If it is good, exit from the loop.
+        if (is_cr_set == 3 || is_cr_set == 5) break;
+        else if (is_cr_set == 2) {
+            
+            if (try == 2) {
+                printf("$> Carrier registration couldn't completed.\n");
+                printf("$> Pico will be reboot in 3 seconds.\n");
+                // Let the Pico to sleep for 3 seconds to show the information to user.
+                telit_sleep_ms(3000);
+                // Reboot the Pico.
+                telit_reboot();
+            }
+
+            printf("$> Waiting for 10 second.\n");
+            telit_sleep_ms(10000);
+        }
+        else if (is_cr_set == 0 || is_cr_set == 3) {
+            printf("\n$> ERROR: Return [0 or 3]. Not Implemented.\n");
+        }
+    }
+
+    printf("$> Carrier registration check completed.\n");
+}
+
+/**
+ * @brief Checks carrier registration with +CREG command.
+ * 
+ * @return uint8_t 
+ */
+uint8_t check_carrier_registration() {
+    // The answer looks like "+CREG: 0,1".
+    telit_query_result_t answer;
+    if (telit_query(TELIT_QUERY_CARRIER, NULL, &answer)) return 0;
+
+    return answer.numbers[1];
+}
+
+/**
+ * @brief This function does the automation of 
+ * checking signal quality. It tries for 10 times,
+ * and if nothing, it reboots the Pico.
+ */
+void process_signal_quailty() {
+    bool is_sq_good = false;
+
+    // Try to get signal quality for 5 times, if it is bad, reboot it.
+    for (int try = 0; try < 3; try++) {
+        printf("$> Checking signal quality... (%d)\n", try+1);
+        is_sq_good = !check_signal_quality();
+        // If it is good, exit from the loop.
+        if (is_sq_good) break;
+        printf("$> Waiting for 5 second.\n");
+        telit_sleep_ms(5000);
+    }
+    
+    if (!is_sq_good) {
+        printf("$> Signal quality is bad.\n$> Please check the antenna.\n");
+        printf("$> Pico will be reboot in 3 seconds.\n");
+        // Let the Pico to sleep for 3 seconds to show the information to user.
+        telit_sleep_ms(3000);
+        // Reboot the Pico.
+        telit_reboot();
+    } else
+        printf("$> Signal quality is good.\n");
+}
+
+/**
+ * @brief Function checks the signal quality of the TELIT modem. If it is below than 70,
+ * returns False. Otherwise, returns True.
+ * 
+ * @return true
+ * @return false 
+ */
+bool check_signal_quality() {
+    // 99 means the signal is not known.
+    telit_query_result_t answer;
+    return telit_query(TELIT_QUERY_SIGNAL, NULL, &answer) || answer.numbers[0] <= 0 || answer.numbers[0] >= 70;
+}
+
+/**
+ * @brief Writes the bytes to the modem, every write goes through here.
+ */
+static void telit_write(const uint8_t data[], size_t length) {
+    // The capture is of one line, the one of the default modem.
+    if (modem == &default_modem) TELIT_CAPTURE_TX((uint32_t) telit_now_us(), data, length);
+    modem->port.write(modem->port.user, data, length);
+}
+
+/**
+ * @brief Writes the line of a command to the modem, and tells the parser
+ * that its answer is on the way.
+ * 
+ * @param line The command with "AT" and CR+LF.
+ */
+static void telit_write_line(const char line[], uint16_t length) {
+    // Take what's left from the old message, then forget its answer.
+    telit_process_rx();
+    modem->has_last_info = false;
+    memset(modem->message_buffer, '\0', sizeof(char) * TELIT_BUFFER_SIZE);
+    modem->message_buffer_index = 0;
+
+    // Send the command to the TELIT.
+    modem->last_echo[0] = '\0';
+    modem->is_message_finished = false;
+    modem->is_prompt_received = false;
+    telit_parser_expect(&modem->parser, line + 2);
+    TELIT_TRACE(AT, TELIT_TRACE_CMD_WRITE, length, TELIT_TRACE_TAG(modem->parser.tag));
+    telit_stats_begin(&modem->command_stats, modem->parser.tag, telit_now_us());
+    telit_write((const uint8_t*) line, length);
+}
+
+/**
+ * @brief Writes the payload of the command being sent, taking it from the
+ * source TELIT_STREAM_CHUNK_SIZE bytes at a time.
+ *
+ * @return uint32_t The bytes written; less than the length if the source ran dry.
+ */
+static uint32_t telit_write_data(uint32_t length, telit_data_source_t source, void* user) {
+    uint8_t chunk[TELIT_STREAM_CHUNK_SIZE];
+    uint32_t offset = 0;
+
+    while (offset < length) {
+        uint16_t size = (length - offset < sizeof(chunk)) ? length - offset : sizeof(chunk);
+        uint16_t written = source(chunk, size, offset, user);
+        if (written == 0 || written > size) break;
+
+        telit_write(chunk, written);
+        offset += written;
+
+        // Keep the ring empty, the modem may echo the data as it comes.
+        telit_process_rx();
+    }
+
+    return offset;
+}
+
+/**
+ * @brief Waits for the "> " of the command being sent.
+ *
+ * @return true The command finished without it, or the time is over.
+ * @return false The modem waits for the data.
+ */
+static bool telit_wait_prompt(uint32_t timeout_ms) {
+    uint64_t deadline_us = telit_now_us() + (uint64_t) timeout_ms * 1000;
+
+    while (!modem->is_prompt_received) {
+        uint64_t now_us = telit_now_us();
+        if (modem->is_message_finished || now_us >= deadline_us) return true;
+
+        modem->port.wait_ms(modem->port.user, (deadline_us - now_us + 999) / 1000);
+        telit_process_rx();
+    }
+
+    return false;
+}
+
+/**
+ * @brief Puts "AT" on the front of the command, and CR+LF on the end, then
+ * writes it. A command which doesn't fit fails with ERROR.
+ * 
+ * @param message The command after "AT".
+ */
+static void telit_write_command(const char message[]) {
+    telit_cmd_t cmd;
+    telit_cmd_begin(&cmd, modem->tx_line, sizeof(modem->tx_line), TELIT_CMD_RAW);
+    telit_cmd_append(&cmd, message);
+
+    if (telit_cmd_end(&cmd)) {
+        modem->message_result = TELIT_RESULT_ERROR;
+        modem->is_message_finished = true;
+        return;
+    }
+
+    telit_write_line(cmd.buffer, cmd.length);
+}
+
+/**
+ * @brief It sends a message consits of "AT" on the front, 
+ * message on the middle, and "\r\n" on the end. The submitted commands
+ * are completed first, since they share the answer of the modem.
+ * 
+ * @param message The command after "AT".
+ */
+void send_message_to_telit(char message[]) {
+    telit_wait_idle();
+    telit_write_command(message);
+}
+
+/**
+ * @brief Sends a command built with telit_cmd_begin() ... telit_cmd_end()
+ * as it is, without copying it.
+ * 
+ * @return true The command didn't fit in its buffer, it is not sent.
+ * @return false The command is sent.
+ */
+bool send_command_to_telit(const telit_cmd_t* cmd) {
+    if (cmd->is_overflow) return true;
+
+    telit_wait_idle();
+    telit_write_line(cmd->buffer, cmd->length);
+    return false;
+}
+
+/**
+ * @brief Waits until every submitted command is finished.
+ */
+static void telit_wait_idle() {
+    while (!telit_is_idle()) {
+        modem->port.wait_ms(modem->port.user, 1);
+        telit_poll();
+    }
+}
+
+/**
+ * @brief Puts the command in the queue without waiting for the modem.
+ * It is sent by telit_poll() as soon as the commands before it are finished.
+ * 
+ * @param command The command after "AT", it is copied.
+ * @param timeout_ms The longest time the command may take.
+ * @param on_complete Called with the final result code. It may be NULL.
+ * @return true The queue is full, or the command is too long.
+ * @return false The command is queued.
+ */
+bool telit_submit(const char command[], uint32_t timeout_ms, telit_command_callback_t on_complete, void* user) {
+    if (modem->command_count == TELIT_COMMAND_QUEUE_SIZE || strlen(command) >= TELIT_COMMAND_SIZE)
+        return true;
+
+    telit_command_t* entry = &modem->command_queue[(modem->command_head + modem->command_count) % TELIT_COMMAND_QUEUE_SIZE];
+    strcpy(entry->command, command);
+    entry->timeout_ms = timeout_ms;
+    entry->on_complete = on_complete;
+    entry->user = user;
+    modem->command_count++;
+    return false;
+}
+
+/**
+ * @brief Runs the queue of the submitted commands. It has to be called from
+ * the main loop; it never waits for the modem. The next command is sent as
+ * soon as the final result code of the previous one is received.
+ */
+void telit_poll() {
+    telit_process_rx();
+
+    while (modem->command_count > 0) {
+        telit_command_t* entry = &modem->command_queue[modem->command_head];
+
+        if (!modem->is_command_sent) {
+            telit_write_command(entry->command);
+            modem->command_deadline_us = telit_now_us() + (uint64_t) entry->timeout_ms * 1000;
+            modem->is_command_sent = true;
+            return;
+        }
+
+        telit_result_t result;
+        if (modem->is_message_finished) result = modem->message_result;
+        else if (telit_now_us() >= modem->command_deadline_us) {
+            result = TELIT_RESULT_TIMEOUT;
+            telit_stats_end(&modem->command_stats, result, telit_now_us());
+            TELIT_TRACE(AT, TELIT_TRACE_CMD_TIMEOUT, 0, TELIT_TRACE_TAG(modem->parser.tag));
+        }
+        else return;
+
+        // Free the entry first, so the callback may submit the next one.
+        telit_command_callback_t on_complete = entry->on_complete;
+        void* user = entry->user;
+        modem->command_head = (modem->command_head + 1) % TELIT_COMMAND_QUEUE_SIZE;
+        modem->command_count--;
+        modem->is_command_sent = false;
+
+        if (on_complete != NULL)
+            on_complete(result, telit_last_info(), user);
+    }
+}
+
+/**
+ * @brief Tells if every submitted command is finished.
+ */
+bool telit_is_idle() {
+    return modem->command_count == 0;
+}
+
+
+/**
+ * @brief Binds the selected modem to a port.
+ */
+void telit_set_port(const telit_port_t* port) {
+    modem->port = *port;
+    telit_parser_init(&modem->parser, telit_on_event, NULL);
+    telit_parser_set_urcs(&modem->parser, &modem->urc_table);
+}
+
+/**
+ * @brief Prepares a modem besides the default one, e.g. on the other UART,
+ * and binds it to its port. It isn't selected.
+ *
+ * @param port NULL binds none, telit_set_port() does it once it is selected.
+ */
+void telit_modem_init(telit_modem_t* instance, const telit_port_t* port) {
+    memset(instance, 0, sizeof(*instance));
+    instance->rx_ring.data = instance->rx_ring_storage;
+    instance->rx_ring.mask = TELIT_RX_RING_SIZE - 1;
+    instance->message_result = TELIT_RESULT_OK;
+    instance->command_stats.pending = -1;
+
+    if (port == NULL) return;
+
+    telit_modem_t* selected = telit_select(instance);
+    telit_set_port(port);
+    telit_select(selected);
+}
+
+/**
+ * @brief Makes the SDK talk to the modem, until another is selected. Only
+ * the core the SDK runs on may call it; the ISR of every modem pushes into
+ * its own ring meanwhile, so nothing is lost while another is selected.
+ *
+ * @return telit_modem_t* The modem selected before, to go back to it.
+ */
+telit_modem_t* telit_select(telit_modem_t* instance) {
+    telit_modem_t* selected = modem;
+    modem = instance;
+    return selected;
+}
+
+telit_modem_t* telit_selected() {
+    return modem;
+}
+
+/**
+ * @brief The modem which is selected at the start; the capture is of its line.
+ */
+telit_modem_t* telit_default_modem() {
+    return &default_modem;
+}
+
+uint64_t telit_now_us() {
+    return modem->port.now_us(modem->port.user);
+}
+
+void telit_sleep_ms(uint32_t ms) {
+    modem->port.sleep_ms(modem->port.user, ms);
+}
+
+void telit_wait_ms(uint32_t timeout_ms) {
+    modem->port.wait_ms(modem->port.user, timeout_ms);
+}
+
+void telit_reboot() {
+    modem->port.reboot(modem->port.user);
+}
+
+/**
+ * @brief Waits until the final result code of the last command is received,
+ * or the timeout is over. It returns as soon as the result is parsed.
+ * 
+ * @param timeout_ms The longest time the command may take.
+ * @return telit_result_t 
+ */
+telit_result_t telit_wait_final(uint32_t timeout_ms) {
+    uint64_t deadline_us = telit_now_us() + (uint64_t) timeout_ms * 1000;
+
+    while (!modem->is_message_finished) {
+        uint64_t now_us = telit_now_us();
+        if (now_us >= deadline_us) {
+            telit_stats_end(&modem->command_stats, TELIT_RESULT_TIMEOUT, now_us);
+            TELIT_TRACE(AT, TELIT_TRACE_CMD_TIMEOUT, 0, TELIT_TRACE_TAG(modem->parser.tag));
+            return TELIT_RESULT_TIMEOUT;
+        }
+
+        // Sleep until something is received, or the deadline.
+        modem->port.wait_ms(modem->port.user, (deadline_us - now_us + 999) / 1000);
+        telit_process_rx();
+    }
+
+    return modem->message_result;
+}
+
+/**
+ * @brief Gives the last information response of the last command,
+ * e.g. "+CSQ: 12,0" with its fields decoded.
+ * 
+ * @return const telit_event_t* NULL if the command has none.
+ */
+const telit_event_t* telit_last_info() {
+    return modem->has_last_info ? &modem->last_info : NULL;
+}
+
+/**
+ * @brief Latency histograms and error counters of every command type since
+ * the start.
+ */
+const telit_stats_t* telit_command_stats() {
+    return &modem->command_stats;
+}
+
+/**
+ * @brief Calls the handler for every URC of the given tag as soon as it is
+ * received, e.g. "#MQRING", "+CREG" or "NO CARRIER". The handler runs in
+ * telit_process_rx(), so it must not send commands.
+ * 
+ * @return true The handler couldn't added.
+ * @return false The handler is added.
+ */
+bool telit_on_urc(const char tag[], telit_urc_handler_t handler, void* user) {
+    return telit_urc_register(&modem->urc_table, tag, handler, user);
+}
+
+bool telit_remove_urc(const char tag[], telit_urc_handler_t handler) {
+    return telit_urc_unregister(&modem->urc_table, tag, handler);
+}
+
+/**
+ * @brief Ring the port pushes the received bytes of the selected modem
+ * into, from the ISR.
+ * 
+ * @return telit_ring_t* 
+ */
+telit_ring_t* telit_rx_ring() {
+    return &modem->rx_ring;
+}
+
+/**
+ * @brief Handles the events of the parser as the bytes arrive.
+ * 
+ * @param event The event parsed.
+ * @param user Not used.
+ */
+static void telit_on_event(const telit_event_t* event, void* user) {
+    switch (event->type) {
+        case TELIT_EVENT_INFO:
+            // "#MQCONN: 2,..." of a query belongs to another client, only the selected one is seen.
+            if (strncmp(event->line, "#MQ", 3) == 0 && telit_event_is_number(event, 0) && event->fields[0] != mqtt_client_id())
+                break;
+
+            // "#SGACT?" answers a line for every PDP context, only the context 1 of the SDK is seen.
+            if (telit_event_is(event, "#SGACT") && event->field_count == 2 && telit_event_is_number(event, 0) && event->fields[0] != 1)
+                break;
+
+            // Keep it, the line of the parser is reused for the next one.
+            modem->last_info = *event;
+            memcpy(modem->last_info_line, event->line, event->length + 1);
+            modem->last_info.line = modem->last_info_line;
+            modem->has_last_info = true;
+
+            if (modem->info_collector != NULL && modem->info_collector(event, modem->info_collector_user)) break;
+
+            // "#MQREAD: <instance>,<topic>,<length>" is followed by the payload.
+            if (telit_event_is(event, "#MQREAD") && event->field_count == 3 && event->fields[2] >= 0) {
+                modem->read_total = event->fields[2];
+                modem->read_remaining = modem->read_total;
+                telit_parser_expect_data(&modem->parser, modem->read_remaining);
+                if (modem->read_handler != NULL && modem->read_remaining == 0)
+                    mqtt_deliver_view((const uint8_t*) modem->message_buffer, 0);
+            }
+            break;
+
+        case TELIT_EVENT_DATA: {
+            uint32_t offset = modem->read_total - modem->read_remaining;
+            modem->read_remaining -= (event->length < modem->read_remaining) ? event->length : modem->read_remaining;
+
+            // The payload of mqtt_read_stream() is not kept at all.
+            if (modem->data_sink != NULL) {
+                modem->data_sink((const uint8_t*) event->line, event->length, offset, modem->read_total, modem->data_sink_user);
+                break;
+            }
+
+            // The whole payload is in one piece of the RX ring, it is given as it is.
+            if (modem->read_handler != NULL && modem->message_buffer_index == 0 && modem->read_remaining == 0) {
+                mqtt_deliver_view((const uint8_t*) event->line, event->length);
+                break;
+            }
+
+            // The buffer has to stay terminated, what doesn't fit is dropped.
+            for (uint16_t index = 0; index < event->length && modem->message_buffer_index < TELIT_BUFFER_SIZE - 1; index++)
+                modem->message_buffer[modem->message_buffer_index++] = event->line[index];
+
+            if (modem->read_handler != NULL && modem->read_remaining == 0)
+                mqtt_deliver_view((const uint8_t*) modem->message_buffer, modem->message_buffer_index);
+            break;
+        }
+
+        case TELIT_EVENT_ECHO:
+            snprintf(modem->last_echo, sizeof(modem->last_echo), "%.*s", event->length, event->line);
+            break;
+
+        case TELIT_EVENT_PROMPT:
+            TELIT_TRACE(AT, TELIT_TRACE_PROMPT, 0, 0, 0);
+            modem->is_prompt_received = true;
+            break;
+
+        case TELIT_EVENT_FINAL:
+            if (event->result == TELIT_RESULT_OK) modem->is_echo_off = modem->last_echo[0] == '\0';
+            telit_stats_end(&modem->command_stats, event->result, telit_now_us());
+            TELIT_TRACE(AT, TELIT_TRACE_CMD_FINAL, event->result, TELIT_TRACE_TAG(modem->parser.tag));
+            modem->message_result = event->result;
+            modem->is_message_finished = true;
+            break;
+
+        case TELIT_EVENT_URC:
+            TELIT_TRACE(AT, TELIT_TRACE_URC, event->length, TELIT_TRACE_TAG(event->line));
+            telit_urc_dispatch(&modem->urc_table, event);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Takes everything the ISR has received so far out of the ring.
+ * It has to be called from the main loop, not from an ISR.
+ */
+void telit_process_rx() {
+    const uint8_t* data;
+    size_t length;
+
+    while ((length = telit_ring_peek(&modem->rx_ring, &data)) > 0) {
+        // A payload of mqtt_read_all() waits in the ring until it is all there,
+        // if it can be there in one piece; then it is given without a copy.
+        if (modem->read_handler != NULL && modem->parser.state == TELIT_PARSER_DATA && modem->message_buffer_index == 0
+            && length < modem->parser.data_remaining
+            && (modem->rx_ring.tail & modem->rx_ring.mask) + modem->parser.data_remaining <= modem->rx_ring.mask + 1)
+            break;
+
+        telit_ring_consume(&modem->rx_ring, telit_parser_feed(&modem->parser, data, length));
+    }
+
+    if (modem->rx_ring.overflows != modem->traced_overflows) {
+        modem->traced_overflows = modem->rx_ring.overflows;
+        TELIT_TRACE(AT, TELIT_TRACE_RX_OVERFLOW, 0, modem->traced_overflows, 0);
+    }
+}
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telit.h"
+#include "telit_attach.h"
+
+// What every step queries, and where it goes back to when it keeps failing.
+typedef struct attach_step {
+    const char*             name;
+    telit_query_id_t        query;
+    telit_attach_state_t    fallback;
+} attach_step_t;
+
+static const attach_step_t steps[] = {
+    [TELIT_ATTACH_IDLE]         = { "idle",             TELIT_QUERY_COUNT,          TELIT_ATTACH_IDLE },
+    [TELIT_ATTACH_SIGNAL]       = { "signal quality",   TELIT_QUERY_SIGNAL,         TELIT_ATTACH_SIGNAL },
+    [TELIT_ATTACH_CARRIER]      = { "carrier",          TELIT_QUERY_CARRIER,        TELIT_ATTACH_SIGNAL },
+    [TELIT_ATTACH_GPRS]         = { "GPRS",             TELIT_QUERY_GPRS,           TELIT_ATTACH_CARRIER },
+    [TELIT_ATTACH_GPRS_ATTACH]  = { "GPRS attach",      TELIT_QUERY_GPRS_ATTACH,    TELIT_ATTACH_GPRS },
+    [TELIT_ATTACH_APN]          = { "APN",              TELIT_QUERY_APN,            TELIT_ATTACH_GPRS_ATTACH },
+    [TELIT_ATTACH_PDP]          = { "PDP context",      TELIT_QUERY_PDP,            TELIT_ATTACH_GPRS_ATTACH },
+    [TELIT_ATTACH_PDP_ACTIVATE] = { "PDP activation",   TELIT_QUERY_PDP_ACTIVATE,   TELIT_ATTACH_GPRS_ATTACH },
+    [TELIT_ATTACH_READY]        = { "ready",            TELIT_QUERY_COUNT,          TELIT_ATTACH_READY },
+};
+
+static void attach_notify(telit_attach_t* attach, telit_attach_event_t event) {
+    TELIT_TRACE(ATTACH, TELIT_TRACE_ATTACH_EVENT, attach->state, event, attach->delay_ms);
+
+    if (attach->callback != NULL)
+        attach->callback(attach, event, attach->user);
+}
+
+static void attach_enter(telit_attach_t* attach, telit_attach_state_t state) {
+    attach->state = state;
+    attach->attempt = 0;
+
+    if (state == TELIT_ATTACH_READY)
+        attach->ready_us = telit_now_us();
+
+    attach_notify(attach, TELIT_ATTACH_ENTERED);
+}
+
+/**
+ * @brief The backoff of the given failures in a row, with jitter so that
+ * many devices don't retry in step after a cell outage.
+ */
+static uint32_t attach_backoff_ms(telit_attach_t* attach, uint8_t failures) {
+    const telit_backoff_t* backoff = &attach->backoff;
+    uint64_t delay_ms = backoff->initial_ms;
+
+    for (uint8_t i = 1; i < failures && delay_ms < backoff->max_ms; i++)
+        delay_ms *= backoff->factor;
+    if (delay_ms > backoff->max_ms) delay_ms = backoff->max_ms;
+
+    if (backoff->jitter_percent > 0 && delay_ms > 0) {
+        // xorshift32, the quality of the numbers doesn't matter here.
+        attach->random ^= attach->random << 13;
+        attach->random ^= attach->random >> 17;
+        attach->random ^= attach->random << 5;
+
+        uint32_t span = delay_ms * backoff->jitter_percent / 100;
+        delay_ms = delay_ms - span + attach->random % (2 * span + 1);
+    }
+
+    return delay_ms;
+}
+
+static void attach_fail(telit_attach_t* attach) {
+    attach->retries++;
+    attach->attempt++;
+    if (attach->failures < UINT8_MAX) attach->failures++;
+
+    attach->delay_ms = attach_backoff_ms(attach, attach->failures);
+    attach->retry_at_us = telit_now_us() + (uint64_t) attach->delay_ms * 1000;
+
+    if (attach->attempt < attach->max_attempts) {
+        attach_notify(attach, TELIT_ATTACH_RETRY);
+        return;
+    }
+
+    attach_notify(attach, TELIT_ATTACH_FALLBACK);
+    attach_enter(attach, steps[attach->state].fallback);
+}
+
+static void attach_succeed(telit_attach_t* attach, telit_attach_state_t next) {
+    attach->failures = 0;
+    attach->retry_at_us = 0;
+    attach_enter(attach, next);
+}
+
+// 1 is the home network, 5 is roaming.
+static bool is_registered(int32_t status) {
+    return status == 1 || status == 5;
+}
+
+/**
+ * @brief Decides the next step from the answer of the command of the
+ * current step.
+ */
+static void attach_on_complete(telit_result_t result, const telit_event_t* info, void* user) {
+    telit_attach_t* attach = (telit_attach_t*) user;
+    attach->is_busy = false;
+
+    // A URC has moved it to another step meanwhile.
+    if (attach->state != attach->busy_state) return;
+
+    if (result != TELIT_RESULT_OK) {
+        attach_fail(attach);
+        return;
+    }
+
+    // The answers of the queries are checked against their schema first.
+    telit_query_result_t answer;
+    bool is_failed = telit_query_decode(steps[attach->state].query, result, info, &answer);
+
+    switch (attach->state) {
+        case TELIT_ATTACH_SIGNAL:
+            // 99 means the signal is not known.
+            if (!is_failed && answer.numbers[0] > 0 && answer.numbers[0] < 70) {
+                attach->rssi = answer.numbers[0];
+                attach_succeed(attach, TELIT_ATTACH_CARRIER);
+            }
+            else attach_fail(attach);
+            break;
+
+        case TELIT_ATTACH_CARRIER:
+            if (!is_failed && is_registered(answer.numbers[1])) attach_succeed(attach, TELIT_ATTACH_GPRS);
+            else attach_fail(attach);
+            break;
+
+        case TELIT_ATTACH_GPRS:
+            if (!is_failed && is_registered(answer.numbers[1])) attach_succeed(attach, TELIT_ATTACH_GPRS_ATTACH);
+            else attach_fail(attach);
+            break;
+
+        case TELIT_ATTACH_GPRS_ATTACH:
+            if (!is_failed && answer.numbers[0] == 1) attach_succeed(attach, TELIT_ATTACH_APN);
+            else attach_fail(attach);
+            break;
+
+        case TELIT_ATTACH_APN:
+            attach_succeed(attach, TELIT_ATTACH_PDP);
+            break;
+
+        case TELIT_ATTACH_PDP:
+            // "#SGACT: 1,1" the context is active already; the lines of the other contexts are skipped.
+            if (!is_failed && answer.numbers[0] == 1 && answer.numbers[1] == 1)
+                attach_succeed(attach, TELIT_ATTACH_READY);
+            else
+                attach_succeed(attach, TELIT_ATTACH_PDP_ACTIVATE);
+            break;
+
+        case TELIT_ATTACH_PDP_ACTIVATE: {
+            // "#SGACT: <ip address>"; a text too long for an IPv4 address is not one, it is left empty.
+            size_t length = strlen(answer.text);
+            if (length >= sizeof(attach->ip_address)) length = 0;
+            memcpy(attach->ip_address, answer.text, length);
+            attach->ip_address[length] = '\0';
+            attach_succeed(attach, TELIT_ATTACH_READY);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Registration URCs cut the backoff short, and a lost registration
+ * takes a ready connection back to the registration steps.
+ */
+static void attach_on_registration(const telit_event_t* event, void* user) {
+    telit_attach_t* attach = (telit_attach_t*) user;
+    bool is_gprs = telit_event_is(event, "+CGREG");
+
+    // "+CREG: <stat>", the answers of the queries have two fields.
+    if (event->field_count != 1) return;
+
+    if (is_registered(event->fields[0])) {
+        if (attach->state == (is_gprs ? TELIT_ATTACH_GPRS : TELIT_ATTACH_CARRIER))
+            attach->retry_at_us = 0;
+    }
+    else if (attach->state > (is_gprs ? TELIT_ATTACH_GPRS : TELIT_ATTACH_CARRIER)) {
+        attach_notify(attach, TELIT_ATTACH_FALLBACK);
+        attach_enter(attach, is_gprs ? TELIT_ATTACH_GPRS : TELIT_ATTACH_CARRIER);
+    }
+}
+
+/**
+ * @brief Prepares the bring-up with the default backoff. The backoff and
+ * max_attempts can be changed before telit_attach_start().
+ *
+ * @param apn Access point name of the PDP context.
+ * @param callback Called on every step, retry and fallback. It may be NULL.
+ */
+void telit_attach_init(telit_attach_t* attach, const char* apn, telit_attach_callback_t callback, void* user) {
+    memset(attach, 0, sizeof(*attach));
+    attach->backoff.initial_ms = TELIT_ATTACH_BACKOFF_INITIAL_MS;
+    attach->backoff.max_ms = TELIT_ATTACH_BACKOFF_MAX_MS;
+    attach->backoff.factor = 2;
+    attach->backoff.jitter_percent = TELIT_ATTACH_BACKOFF_JITTER_PERCENT;
+    attach->max_attempts = TELIT_ATTACH_MAX_ATTEMPTS;
+    snprintf(attach->apn, sizeof(attach->apn), "%s", apn);
+    attach->callback = callback;
+    attach->user = user;
+
+    // Initilizing it again must not add the handlers twice.
+    telit_remove_urc("+CREG", attach_on_registration);
+    telit_remove_urc("+CGREG", attach_on_registration);
+    telit_on_urc("+CREG", attach_on_registration, attach);
+    telit_on_urc("+CGREG", attach_on_registration, attach);
+}
+
+static void attach_begin(telit_attach_t* attach, telit_attach_state_t state) {
+    attach->started_us = telit_now_us();
+    attach->ready_us = 0;
+    attach->retries = 0;
+    attach->failures = 0;
+    attach->retry_at_us = 0;
+    attach->random = (uint32_t) attach->started_us | 1;
+    attach_enter(attach, state);
+}
+
+void telit_attach_start(telit_attach_t* attach) {
+    attach_begin(attach, TELIT_ATTACH_SIGNAL);
+}
+
+/**
+ * @brief Starts the bring-up from where the modem is. The modem keeps
+ * running over a reboot of the board, so its PDP context may still be
+ * active; then one "#SGACT?" makes it ready instead of every step. It
+ * waits for the answer, as telit_query() does.
+ *
+ * @return true The context is not active, the bring-up starts from the signal.
+ * @return false The context is active, it is ready.
+ */
+bool telit_attach_resume(telit_attach_t* attach) {
+    telit_query_result_t answer;
+    bool is_active = !telit_query(TELIT_QUERY_PDP, NULL, &answer) && answer.numbers[0] == 1 && answer.numbers[1] == 1;
+
+    attach_begin(attach, is_active ? TELIT_ATTACH_READY : TELIT_ATTACH_SIGNAL);
+    return !is_active;
+}
+
+/**
+ * @brief Moves the bring-up forward without waiting. It has to be called
+ * from the main loop together with telit_poll(), which runs the commands.
+ *
+ * @return telit_attach_state_t The current step.
+ */
+telit_attach_state_t telit_attach_step(telit_attach_t* attach) {
+    if (attach->state == TELIT_ATTACH_IDLE || attach->state == TELIT_ATTACH_READY || attach->is_busy)
+        return attach->state;
+
+    if (telit_now_us() < attach->retry_at_us)
+        return attach->state;
+
+    const attach_step_t* step = &steps[attach->state];
+    char line[TELIT_COMMAND_SIZE + 4];
+    telit_cmd_t cmd;
+
+    // Only the APN step has an argument.
+    if (telit_query_command(step->query, (attach->state == TELIT_ATTACH_APN) ? attach->apn : NULL, &cmd, line, sizeof(line))) {
+        attach_fail(attach);
+        return attach->state;
+    }
+
+    // The queue takes the command without "AT" and CR+LF.
+    line[cmd.length - 2] = '\0';
+
+    // The queue may be full, then it is tried on the next step.
+    if (!telit_submit(telit_cmd_body(&cmd), telit_queries[step->query].timeout_ms, attach_on_complete, attach)) {
+        attach->is_busy = true;
+        attach->busy_state = attach->state;
+    }
+
+    return attach->state;
+}
+
+/**
+ * @brief Time from the start to the ready state, or until now if it is not
+ * ready yet.
+ */
+uint32_t telit_attach_elapsed_ms(const telit_attach_t* attach) {
+    uint64_t end_us = (attach->state == TELIT_ATTACH_READY) ? attach->ready_us : telit_now_us();
+    return (end_us - attach->started_us) / 1000;
+}
+
+const char* telit_attach_state_name(telit_attach_state_t state) {
+    return (state <= TELIT_ATTACH_READY) ? steps[state].name : "unknown";
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telit.h"
+#include "telit_batch.h"
+#include "telit_store.h"
+
+/**
+ * @brief Prepares an empty batch of the topic.
+ *
+ * @param window_ms The longest time an update waits to be published.
+ * @param max_payload The payload is published when it would grow past it.
+ * It is at most TELIT_BATCH_PAYLOAD_SIZE.
+ * @return true The topic is too long, or the threshold is too big.
+ * @return false The batch is ready.
+ */
+bool telit_batch_init(telit_batch_t* batch, const char* topic, uint32_t window_ms, uint16_t max_payload) {
+    memset(batch, 0, sizeof(*batch));
+    if (strlen(topic) >= sizeof(batch->topic) || max_payload == 0 || max_payload >= TELIT_BATCH_PAYLOAD_SIZE)
+        return true;
+
+    strcpy(batch->topic, topic);
+    batch->window_ms = window_ms;
+    batch->max_payload = max_payload;
+    return false;
+}
+
+/**
+ * @brief The publishes which fail are kept in the store, and sent again by
+ * telit_store_forward(). NULL turns it off.
+ */
+void telit_batch_set_store(telit_batch_t* batch, struct telit_store* store) {
+    batch->store = store;
+}
+
+/**
+ * @brief Sets the value of the key for the next publish. If the payload
+ * would grow past the threshold, the window is flushed first.
+ *
+ * @return true The key or the value is too long, or the flush failed.
+ * @return false The update is in the batch.
+ */
+bool telit_batch_set(telit_batch_t* batch, const char* key, const char* value) {
+    size_t key_length = strlen(key);
+    size_t value_length = strlen(value);
+    if (key_length >= TELIT_BATCH_KEY_SIZE || value_length >= TELIT_BATCH_VALUE_SIZE)
+        return true;
+
+    batch->updates++;
+    bool is_full = false;
+
+    // The latest value of a key replaces the one in the window.
+    for (uint8_t i = 0; i < batch->field_count; i++) {
+        telit_batch_field_t* field = &batch->fields[i];
+        if (strcmp(field->key, key) != 0) continue;
+
+        uint16_t length = batch->payload_length - strlen(field->value) + value_length;
+        if (length <= batch->max_payload) {
+            strcpy(field->value, value);
+            batch->payload_length = length;
+            batch->coalesced++;
+            return false;
+        }
+
+        // The new value doesn't fit, it goes to the next window.
+        is_full = true;
+        break;
+    }
+
+    // "&key=value", the first field has no '&'.
+    uint16_t field_length = key_length + 1 + value_length + (batch->field_count > 0 ? 1 : 0);
+    is_full = is_full || batch->field_count == TELIT_BATCH_MAX_FIELDS || batch->payload_length + field_length > batch->max_payload;
+
+    bool has_failed = false;
+    if (is_full) {
+        has_failed = telit_batch_flush(batch);
+        field_length = key_length + 1 + value_length;
+        if (field_length > batch->max_payload) return true;
+    }
+
+    if (batch->field_count == 0) batch->opened_us = telit_now_us();
+
+    telit_batch_field_t* field = &batch->fields[batch->field_count++];
+    strcpy(field->key, key);
+    strcpy(field->value, value);
+    batch->payload_length += field_length;
+    return has_failed;
+}
+
+bool telit_batch_set_int(telit_batch_t* batch, const char* key, int32_t value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%ld", (long) value);
+    return telit_batch_set(batch, key, text);
+}
+
+/**
+ * @brief Publishes the batch if its window is over. It has to be called
+ * from the main loop.
+ *
+ * @return true The flush failed.
+ * @return false Nothing is due, or the batch is published.
+ */
+bool telit_batch_poll(telit_batch_t* batch) {
+    if (batch->field_count == 0) return false;
+    if (telit_now_us() - batch->opened_us < (uint64_t) batch->window_ms * 1000) return false;
+
+    return telit_batch_flush(batch);
+}
+
+/**
+ * @brief Publishes every update of the window as one message now. The
+ * window is emptied even if the publish fails, so old values are not sent
+ * after newer ones. With a store, a failed publish is stored instead.
+ *
+ * @return true The publish failed, and it is not stored.
+ * @return false The batch is published or stored, or it is empty.
+ */
+bool telit_batch_flush(telit_batch_t* batch) {
+    if (batch->field_count == 0) return false;
+
+    char payload[TELIT_BATCH_PAYLOAD_SIZE];
+    uint16_t length = 0;
+
+    for (uint8_t i = 0; i < batch->field_count; i++) {
+        const telit_batch_field_t* field = &batch->fields[i];
+        size_t key_length = strlen(field->key);
+        size_t value_length = strlen(field->value);
+
+        if (i > 0) payload[length++] = '&';
+        memcpy(payload + length, field->key, key_length);
+        length += key_length;
+        payload[length++] = '=';
+        memcpy(payload + length, field->value, value_length);
+        length += value_length;
+    }
+    payload[length] = '\0';
+
+    batch->field_count = 0;
+    batch->payload_length = 0;
+
+    bool is_failed = (batch->store != NULL)
+        ? telit_store_publish(batch->store, batch->topic, payload)
+        : mqtt_publish(batch->topic, payload);
+
+    if (is_failed) {
+        batch->failures++;
+        return true;
+    }
+
+    batch->flushes++;
+    batch->flushed_bytes += length;
+    return false;
+}
+
+/**
+ * @brief How full the published payloads are on average, from 0 to 1.
+ */
+float telit_batch_fill_ratio(const telit_batch_t* batch) {
+    if (batch->flushes == 0) return 0.0f;
+    return (float) batch->flushed_bytes / ((float) batch->flushes * batch->max_payload);
+}
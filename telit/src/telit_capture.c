@@ -0,0 +1,240 @@
+#include <string.h>
+
+#include "telit_capture.h"
+
+_Static_assert((TELIT_CAPTURE_RING_SIZE & (TELIT_CAPTURE_RING_SIZE - 1)) == 0, "TELIT_CAPTURE_RING_SIZE has to be a power of two");
+
+// A record in a ring: <time_us: 4> <length: 1> <bytes>.
+#define CAPTURE_ENTRY_HEADER 5
+
+typedef struct capture_ring {
+    uint8_t             data[TELIT_CAPTURE_RING_SIZE];
+    volatile uint32_t   head;           // Written by the producer only.
+    volatile uint32_t   tail;           // Written by the consumer only.
+    volatile uint32_t   lost;           // Bytes dropped while the ring was full.
+    uint32_t            lost_reported;  // Consumer only.
+} capture_ring_t;
+
+capture_ring_t  capture_tx;                         // It holds the bytes written by the main loop.
+capture_ring_t  capture_rx;                         // It holds the bytes pushed by the UART ISR.
+volatile bool   is_capture_on = false;              // It is true between telit_capture_start() and _stop().
+bool            is_capture_header_written = false;  // It is true once the drain has written "TCAP".
+uint32_t        capture_last_us = 0;                // It holds the time of the last record drained.
+bool            has_capture_last = false;
+
+static void capture_push(capture_ring_t* ring, uint32_t time_us, const uint8_t* data, size_t length) {
+    if (!is_capture_on) return;
+
+    while (length > 0) {
+        uint8_t size = (length < TELIT_CAPTURE_MAX_CHUNK) ? length : TELIT_CAPTURE_MAX_CHUNK;
+        uint32_t head = ring->head;
+
+        if (TELIT_CAPTURE_RING_SIZE - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) < CAPTURE_ENTRY_HEADER + size) {
+            ring->lost += length;
+            return;
+        }
+
+        for (uint8_t i = 0; i < 4; i++)
+            ring->data[head++ & (TELIT_CAPTURE_RING_SIZE - 1)] = time_us >> (8 * i);
+        ring->data[head++ & (TELIT_CAPTURE_RING_SIZE - 1)] = size;
+        for (uint8_t i = 0; i < size; i++)
+            ring->data[head++ & (TELIT_CAPTURE_RING_SIZE - 1)] = data[i];
+
+        // The record is seen by the drain as a whole.
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+        data += size;
+        length -= size;
+    }
+}
+
+/**
+ * @brief Starts recording. The rings are not cleared, what is still in
+ * them is drained first.
+ */
+void telit_capture_start() {
+    if (TELIT_CAPTURE) is_capture_on = true;
+}
+
+void telit_capture_stop() {
+    is_capture_on = false;
+}
+
+bool telit_capture_is_on() {
+    return is_capture_on;
+}
+
+/**
+ * @brief Records the bytes written to the modem. The main loop calls it.
+ */
+void telit_capture_tx(uint32_t time_us, const uint8_t* data, size_t length) {
+    capture_push(&capture_tx, time_us, data, length);
+}
+
+/**
+ * @brief Records the bytes received from the modem. The port calls it from
+ * the UART ISR, after it has pushed them into the RX ring, with the time it
+ * read itself: the ISR does not go through the modem or its port.
+ */
+void telit_capture_rx(uint32_t time_us, const uint8_t* data, size_t length) {
+    capture_push(&capture_rx, time_us, data, length);
+}
+
+/**
+ * @brief The bytes which didn't fit in the rings since the start.
+ */
+uint32_t telit_capture_lost() {
+    return capture_tx.lost + capture_rx.lost;
+}
+
+static uint8_t capture_leb128(uint8_t* out, uint32_t value) {
+    uint8_t length = 0;
+    do {
+        out[length] = value & 0x7F;
+        value >>= 7;
+        if (value > 0) out[length] |= 0x80;
+        length++;
+    } while (value > 0);
+    return length;
+}
+
+// The delta from the record before; a record which was late to its ring doesn't go back in time.
+static uint8_t capture_delta(uint8_t* out, uint32_t time_us) {
+    uint32_t delta_us = (has_capture_last && (int32_t) (time_us - capture_last_us) > 0) ? time_us - capture_last_us : 0;
+    if (!has_capture_last || (int32_t) (time_us - capture_last_us) > 0) capture_last_us = time_us;
+    has_capture_last = true;
+    return capture_leb128(out, delta_us);
+}
+
+static bool capture_peek(const capture_ring_t* ring, uint32_t* time_us) {
+    uint32_t tail = ring->tail;
+    if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) return false;
+
+    *time_us = 0;
+    for (uint8_t i = 0; i < 4; i++)
+        *time_us |= (uint32_t) ring->data[(tail + i) & (TELIT_CAPTURE_RING_SIZE - 1)] << (8 * i);
+    return true;
+}
+
+static void capture_write_gap(capture_ring_t* ring, uint8_t direction, telit_capture_writer_t writer, void* user) {
+    uint32_t lost = ring->lost;
+    if (lost == ring->lost_reported) return;
+
+    uint8_t record[11];
+    uint8_t length = capture_delta(record, capture_last_us);
+    record[length++] = direction;
+    length += capture_leb128(record + length, lost - ring->lost_reported);
+    writer(record, length, user);
+    ring->lost_reported = lost;
+}
+
+static void capture_write_entry(capture_ring_t* ring, uint32_t time_us, uint8_t direction, telit_capture_writer_t writer, void* user) {
+    uint8_t record[TELIT_CAPTURE_RECORD_SIZE];
+    uint32_t tail = ring->tail + 4;
+    uint8_t size = ring->data[tail++ & (TELIT_CAPTURE_RING_SIZE - 1)];
+
+    uint8_t length = capture_delta(record, time_us);
+    record[length++] = direction | size;
+    for (uint8_t i = 0; i < size; i++)
+        record[length++] = ring->data[tail++ & (TELIT_CAPTURE_RING_SIZE - 1)];
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    writer(record, length, user);
+}
+
+/**
+ * @brief Writes the recorded bytes as records of the log, oldest first.
+ * The header is written before the first record, once there is one. It has to be called from
+ * one place only, e.g. the main loop of the other core.
+ *
+ * @param max_records The most records written in this call, 0 for all.
+ * @return uint32_t The number of the records written.
+ */
+uint32_t telit_capture_drain(uint32_t max_records, telit_capture_writer_t writer, void* user) {
+    uint32_t drained = 0;
+    uint32_t time_us;
+
+    // Nothing is written, not even the header, until something is recorded.
+    if (!capture_peek(&capture_tx, &time_us) && !capture_peek(&capture_rx, &time_us)
+        && capture_tx.lost == capture_tx.lost_reported && capture_rx.lost == capture_rx.lost_reported)
+        return 0;
+
+    if (!is_capture_header_written) {
+        const uint8_t header[TELIT_CAPTURE_HEADER_SIZE] = { 'T', 'C', 'A', 'P', TELIT_CAPTURE_VERSION };
+        writer(header, sizeof(header), user);
+        is_capture_header_written = true;
+    }
+
+    capture_write_gap(&capture_tx, 0, writer, user);
+    capture_write_gap(&capture_rx, TELIT_CAPTURE_FROM_MODEM, writer, user);
+
+    while (max_records == 0 || drained < max_records) {
+        uint32_t tx_us, rx_us;
+        bool has_tx = capture_peek(&capture_tx, &tx_us);
+        bool has_rx = capture_peek(&capture_rx, &rx_us);
+        if (!has_tx && !has_rx) break;
+
+        // The 32-bit times are compared across their wrap.
+        if (has_tx && (!has_rx || (int32_t) (tx_us - rx_us) <= 0))
+            capture_write_entry(&capture_tx, tx_us, 0, writer, user);
+        else
+            capture_write_entry(&capture_rx, rx_us, TELIT_CAPTURE_FROM_MODEM, writer, user);
+        drained++;
+    }
+
+    return drained;
+}
+
+/**
+ * @brief Checks the header of a log.
+ *
+ * @return true It is not a log of this version.
+ * @return false The records can be read.
+ */
+bool telit_capture_reader_init(telit_capture_reader_t* reader, const uint8_t* data, size_t length) {
+    reader->data = data;
+    reader->length = length;
+    reader->offset = TELIT_CAPTURE_HEADER_SIZE;
+    reader->time_us = 0;
+
+    return length < TELIT_CAPTURE_HEADER_SIZE || memcmp(data, TELIT_CAPTURE_MAGIC, 4) != 0
+        || data[4] != TELIT_CAPTURE_VERSION;
+}
+
+static bool reader_leb128(telit_capture_reader_t* reader, uint32_t* value) {
+    *value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (reader->offset >= reader->length) return true;
+
+        uint8_t byte = reader->data[reader->offset++];
+        *value |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the next record of the log.
+ *
+ * @return true The log is over, or the record is cut.
+ * @return false The record is filled.
+ */
+bool telit_capture_read(telit_capture_reader_t* reader, telit_capture_record_t* record) {
+    uint32_t delta_us;
+    if (reader_leb128(reader, &delta_us) || reader->offset >= reader->length) return true;
+
+    uint8_t kind = reader->data[reader->offset++];
+    reader->time_us += delta_us;
+
+    record->time_us = reader->time_us;
+    record->is_from_modem = (kind & TELIT_CAPTURE_FROM_MODEM) != 0;
+    record->length = kind & TELIT_CAPTURE_MAX_CHUNK;
+    record->lost = 0;
+    record->data = reader->data + reader->offset;
+
+    if (record->length == 0)
+        return reader_leb128(reader, &record->lost);
+
+    if (reader->length - reader->offset < record->length) return true;
+    reader->offset += record->length;
+    return false;
+}
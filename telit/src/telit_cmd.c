@@ -0,0 +1,121 @@
+#include <string.h>
+
+#include "telit_cmd.h"
+
+#define TELIT_CMD_PREFIX(text) { text, sizeof(text) - 1 }
+
+// Prefixes of the commands, the arguments follow them. The ones of MQTT
+// take the instance of the client first.
+const telit_cmd_prefix_t telit_cmd_prefixes[TELIT_CMD_COUNT] = {
+    [TELIT_CMD_RAW]             = TELIT_CMD_PREFIX(""),
+    [TELIT_CMD_CSQ]             = TELIT_CMD_PREFIX("+CSQ"),
+    [TELIT_CMD_IPR]             = TELIT_CMD_PREFIX("+IPR="),
+    [TELIT_CMD_CREG_READ]       = TELIT_CMD_PREFIX("+CREG?"),
+    [TELIT_CMD_CGREG_READ]      = TELIT_CMD_PREFIX("+CGREG?"),
+    [TELIT_CMD_CGATT_READ]      = TELIT_CMD_PREFIX("+CGATT?"),
+    [TELIT_CMD_CGDCONT]         = TELIT_CMD_PREFIX("+CGDCONT=1,\"IP\","),
+    [TELIT_CMD_SGACT_READ]      = TELIT_CMD_PREFIX("#SGACT?"),
+    [TELIT_CMD_SGACT_ACTIVATE]  = TELIT_CMD_PREFIX("#SGACT=1,1"),
+    [TELIT_CMD_MQEN]            = TELIT_CMD_PREFIX("#MQEN="),
+    [TELIT_CMD_MQEN_READ]       = TELIT_CMD_PREFIX("#MQEN?"),
+    [TELIT_CMD_MQWCFG]          = TELIT_CMD_PREFIX("#MQWCFG="),
+    [TELIT_CMD_MQWCFG_READ]     = TELIT_CMD_PREFIX("#MQWCFG?"),
+    [TELIT_CMD_MQCFG]           = TELIT_CMD_PREFIX("#MQCFG="),
+    [TELIT_CMD_MQCFG_READ]      = TELIT_CMD_PREFIX("#MQCFG?"),
+    [TELIT_CMD_MQCFG2]          = TELIT_CMD_PREFIX("#MQCFG2="),
+    [TELIT_CMD_MQCFG2_READ]     = TELIT_CMD_PREFIX("#MQCFG2?"),
+    [TELIT_CMD_MQCONN]          = TELIT_CMD_PREFIX("#MQCONN="),
+    [TELIT_CMD_MQCONN_READ]     = TELIT_CMD_PREFIX("#MQCONN?"),
+    [TELIT_CMD_MQDISC]          = TELIT_CMD_PREFIX("#MQDISC="),
+    [TELIT_CMD_MQSUB]           = TELIT_CMD_PREFIX("#MQSUB="),
+    [TELIT_CMD_MQPUBS]          = TELIT_CMD_PREFIX("#MQPUBS="),
+    [TELIT_CMD_MQPUBSBIN]       = TELIT_CMD_PREFIX("#MQPUBSBIN="),
+    [TELIT_CMD_MQREAD]          = TELIT_CMD_PREFIX("#MQREAD="),
+    [TELIT_CMD_MQREAD_READ]     = TELIT_CMD_PREFIX("#MQREAD?"),
+};
+
+static void cmd_write(telit_cmd_t* cmd, const char* text, uint16_t length) {
+    // 2 bytes are kept for CR+LF, and 1 for the terminator.
+    if (cmd->is_overflow || cmd->length + length + 3 > cmd->size) {
+        cmd->is_overflow = true;
+        return;
+    }
+
+    memcpy(cmd->buffer + cmd->length, text, length);
+    cmd->length += length;
+}
+
+/**
+ * @brief Starts the line with "AT" and the prefix of the command.
+ *
+ * @param buffer Where the line is written. It has to hold "AT", the
+ * command, CR+LF and the terminator.
+ */
+void telit_cmd_begin(telit_cmd_t* cmd, char* buffer, uint16_t size, telit_cmd_id_t id) {
+    const telit_cmd_prefix_t* prefix = &telit_cmd_prefixes[id];
+
+    cmd->buffer = buffer;
+    cmd->size = size;
+    cmd->length = 0;
+    cmd->is_overflow = false;
+    cmd->has_arg = false;
+
+    cmd_write(cmd, "AT", 2);
+    cmd_write(cmd, prefix->text, prefix->length);
+}
+
+void telit_cmd_append(telit_cmd_t* cmd, const char* text) {
+    cmd_write(cmd, text, strlen(text));
+}
+
+void telit_cmd_append_uint(telit_cmd_t* cmd, uint32_t value) {
+    char digits[10];
+    uint8_t count = 0;
+
+    // The digits come from the last one.
+    do {
+        digits[sizeof(digits) - 1 - count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    cmd_write(cmd, digits + sizeof(digits) - count, count);
+}
+
+// The comma goes before every argument but the first one after the prefix,
+// whatever the one before ends with; an empty one still takes its place.
+static void cmd_separate(telit_cmd_t* cmd) {
+    if (cmd->has_arg) cmd_write(cmd, ",", 1);
+    cmd->has_arg = true;
+}
+
+/**
+ * @brief Appends an argument, with a comma before it unless it is the first
+ * one after the prefix.
+ */
+void telit_cmd_arg(telit_cmd_t* cmd, const char* text) {
+    cmd_separate(cmd);
+    telit_cmd_append(cmd, text);
+}
+
+void telit_cmd_arg_uint(telit_cmd_t* cmd, uint32_t value) {
+    cmd_separate(cmd);
+    telit_cmd_append_uint(cmd, value);
+}
+
+/**
+ * @brief Ends the line with CR+LF. The room for them is always kept.
+ *
+ * @return true Something didn't fit in the buffer.
+ * @return false The line is ready to be sent.
+ */
+bool telit_cmd_end(telit_cmd_t* cmd) {
+    if (cmd->is_overflow) {
+        if (cmd->size > 0) cmd->buffer[0] = '\0';
+        return true;
+    }
+
+    cmd->buffer[cmd->length++] = '\r';
+    cmd->buffer[cmd->length++] = '\n';
+    cmd->buffer[cmd->length] = '\0';
+    return false;
+}
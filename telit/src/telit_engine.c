@@ -0,0 +1,274 @@
+#include <string.h>
+
+#include "telit.h"
+#include "telit_engine.h"
+#include "telit_store.h"
+
+_Static_assert((TELIT_ENGINE_QUEUE_SIZE & (TELIT_ENGINE_QUEUE_SIZE - 1)) == 0, "TELIT_ENGINE_QUEUE_SIZE has to be a power of two");
+_Static_assert(TELIT_COMMAND_SIZE <= TELIT_ENGINE_TEXT_SIZE, "A command has to fit in the text of a request");
+
+/**
+ * @brief Prepares empty queues for the selected modem. Call it before
+ * either core uses the engine.
+ *
+ * @param wake Called on the application core after every request, NULL if
+ * the modem core polls.
+ * @param on_step Called on the modem core in every step, it may be NULL.
+ */
+void telit_engine_init(telit_engine_t* engine, telit_engine_hook_t wake, telit_engine_hook_t on_step, void* user) {
+    memset(engine, 0, sizeof(*engine));
+    engine->wake = wake;
+    engine->on_step = on_step;
+    engine->user = user;
+    engine->modem = telit_selected();
+    engine->mqtt_client = mqtt_selected();
+}
+
+/**
+ * @brief Copies the text, if it fits with its terminator.
+ *
+ * @return true It is too long.
+ */
+static bool engine_copy(char* to, size_t size, const char* from) {
+    size_t length = strlen(from);
+    if (length >= size) return true;
+
+    memcpy(to, from, length + 1);
+    return false;
+}
+
+static bool engine_request(telit_engine_t* engine, uint8_t kind, uint32_t token, uint32_t timeout_ms,
+                           const char* topic, const char* text) {
+    uint32_t head = engine->request_head;
+    if (head - __atomic_load_n(&engine->request_tail, __ATOMIC_ACQUIRE) == TELIT_ENGINE_QUEUE_SIZE)
+        return true;
+
+    telit_engine_request_t* request = &engine->requests[head & (TELIT_ENGINE_QUEUE_SIZE - 1)];
+    if (engine_copy(request->topic, sizeof(request->topic), topic)
+        || engine_copy(request->text, (kind == TELIT_ENGINE_COMMAND) ? TELIT_COMMAND_SIZE : sizeof(request->text), text))
+        return true;
+
+    request->kind = kind;
+    request->token = token;
+    request->timeout_ms = timeout_ms;
+    __atomic_store_n(&engine->request_head, head + 1, __ATOMIC_RELEASE);
+
+    if (engine->wake != NULL) engine->wake(engine, engine->user);
+    return false;
+}
+
+/**
+ * @brief Asks the modem core to send the command, e.g. "+CSQ". Its answer
+ * comes back with the token through telit_engine_take(). It never waits.
+ *
+ * @return true The queue is full, or the command is too long.
+ * @return false The command is queued.
+ */
+bool telit_engine_submit(telit_engine_t* engine, const char* command, uint32_t timeout_ms, uint32_t token) {
+    return engine_request(engine, TELIT_ENGINE_COMMAND, token, timeout_ms, "", command);
+}
+
+/**
+ * @brief Asks the modem core to publish the payload. With a store, a
+ * failed publish is kept for later. It never waits.
+ *
+ * @return true The queue is full, or the topic or the payload is too long.
+ * @return false The publish is queued.
+ */
+bool telit_engine_publish(telit_engine_t* engine, const char* topic, const char* payload, uint32_t token) {
+    return engine_request(engine, TELIT_ENGINE_PUBLISH, token, TELIT_MSG_WAIT_MS, topic, payload);
+}
+
+/**
+ * @brief Takes the oldest answer, or message, of the modem core.
+ *
+ * @return true Nothing has come.
+ * @return false The response is filled.
+ */
+bool telit_engine_take(telit_engine_t* engine, telit_engine_response_t* response) {
+    uint32_t tail = engine->response_tail;
+    if (tail == __atomic_load_n(&engine->response_head, __ATOMIC_ACQUIRE)) return true;
+
+    *response = engine->responses[tail & (TELIT_ENGINE_QUEUE_SIZE - 1)];
+    __atomic_store_n(&engine->response_tail, tail + 1, __ATOMIC_RELEASE);
+    return false;
+}
+
+/**
+ * @brief Makes telit_engine_run() return after its step.
+ */
+void telit_engine_stop(telit_engine_t* engine) {
+    engine->is_running = false;
+    if (engine->wake != NULL) engine->wake(engine, engine->user);
+}
+
+/**
+ * @brief The answers which still fit in the queue.
+ */
+static uint32_t engine_room(const telit_engine_t* engine) {
+    return TELIT_ENGINE_QUEUE_SIZE - (engine->response_head - __atomic_load_n(&engine->response_tail, __ATOMIC_ACQUIRE));
+}
+
+static telit_engine_response_t* engine_response_begin(telit_engine_t* engine, uint8_t kind, uint32_t token) {
+    telit_engine_response_t* response = &engine->responses[engine->response_head & (TELIT_ENGINE_QUEUE_SIZE - 1)];
+    response->kind = kind;
+    response->token = token;
+    response->result = TELIT_RESULT_OK;
+    response->length = 0;
+    response->topic[0] = '\0';
+    response->text[0] = '\0';
+    return response;
+}
+
+static void engine_response_end(telit_engine_t* engine) {
+    __atomic_store_n(&engine->response_head, engine->response_head + 1, __ATOMIC_RELEASE);
+}
+
+// Copies what fits of the bytes, and terminates them.
+static uint16_t engine_copy_bytes(char* to, size_t size, const char* from, size_t length) {
+    if (length >= size) length = size - 1;
+    memcpy(to, from, length);
+    to[length] = '\0';
+    return length;
+}
+
+static void engine_on_complete(telit_result_t result, const telit_event_t* info, void* user) {
+    telit_engine_t* engine = (telit_engine_t*) user;
+
+    // The commands complete in the order they are submitted.
+    telit_engine_response_t* response = engine_response_begin(engine, TELIT_ENGINE_COMMAND, engine->tokens[engine->token_head]);
+    engine->token_head = (engine->token_head + 1) % TELIT_COMMAND_QUEUE_SIZE;
+    engine->in_flight--;
+
+    response->result = result;
+    if (info != NULL)
+        response->length = engine_copy_bytes(response->text, sizeof(response->text), info->line, info->length);
+
+    engine_response_end(engine);
+    engine->requests_done++;
+}
+
+static void engine_on_message(const char* topic, const char* payload, uint16_t length, void* user) {
+    telit_engine_t* engine = (telit_engine_t*) user;
+
+    // The room of the answers of the commands on the way is kept. Only the
+    // read of a lost announcement, which takes every message, comes here.
+    if (engine_room(engine) <= engine->in_flight) {
+        engine->lost_messages++;
+        return;
+    }
+
+    telit_engine_response_t* response = engine_response_begin(engine, TELIT_ENGINE_MESSAGE, 0);
+    engine_copy_bytes(response->topic, sizeof(response->topic), topic, strlen(topic));
+    response->length = engine_copy_bytes(response->text, sizeof(response->text), payload, length);
+    engine_response_end(engine);
+}
+
+/**
+ * @brief Takes the MQTT messages of the selected client of the selected
+ * modem over; they are given to the application core as
+ * TELIT_ENGINE_MESSAGE. The engine drives this modem from now on. It has
+ * to be called on the modem core.
+ */
+void telit_engine_start(telit_engine_t* engine) {
+    engine->modem = telit_selected();
+    engine->mqtt_client = mqtt_selected();
+    engine->is_running = true;
+    mqtt_set_message_handler(engine_on_message, engine);
+}
+
+/**
+ * @brief The publishes which fail are kept in the store. NULL turns it off.
+ */
+void telit_engine_set_store(telit_engine_t* engine, struct telit_store* store) {
+    engine->store = store;
+}
+
+/**
+ * @brief Reads the messages announced, as many as the queue of the answers
+ * has room for; the rest wait in the modem.
+ */
+static void engine_read_messages(telit_engine_t* engine) {
+    uint32_t room = engine_room(engine) - engine->in_flight;
+    if (room > 0 && mqtt_announced_messages() > 0)
+        mqtt_process_messages_max((room < UINT8_MAX) ? room : UINT8_MAX);
+}
+
+/**
+ * @brief Runs the commands, reads the messages announced, and takes the
+ * requests. A request is taken only when its answer has room in the queue,
+ * so no answer is lost, and only when no message waits, so the messages
+ * don't pile up in the modem. A publish waits for its answer here, on the
+ * modem core.
+ *
+ * @return true There is still work, e.g. a command on the way.
+ * @return false The engine is idle.
+ */
+bool telit_engine_step(telit_engine_t* engine) {
+    bool is_busy = false;
+    telit_modem_t* selected = telit_select(engine->modem);
+    uint8_t selected_client = mqtt_select(engine->mqtt_client);
+
+    telit_poll();
+    engine_read_messages(engine);
+
+    while (engine->request_tail != __atomic_load_n(&engine->request_head, __ATOMIC_ACQUIRE)
+           && engine_room(engine) > engine->in_flight && mqtt_announced_messages() == 0) {
+        const telit_engine_request_t* request = &engine->requests[engine->request_tail & (TELIT_ENGINE_QUEUE_SIZE - 1)];
+
+        if (request->kind == TELIT_ENGINE_COMMAND) {
+            // The queue of the SDK is full, the request waits where it is.
+            if (telit_submit(request->text, request->timeout_ms, engine_on_complete, engine)) break;
+
+            engine->tokens[(engine->token_head + engine->in_flight) % TELIT_COMMAND_QUEUE_SIZE] = request->token;
+            engine->in_flight++;
+            __atomic_store_n(&engine->request_tail, engine->request_tail + 1, __ATOMIC_RELEASE);
+        }
+        else {
+            char topic[TELIT_ENGINE_TOPIC_SIZE];
+            char payload[TELIT_ENGINE_TEXT_SIZE];
+            uint32_t token = request->token;
+            strcpy(topic, request->topic);
+            strcpy(payload, request->text);
+
+            // The slot is given back first, the publish takes a while.
+            __atomic_store_n(&engine->request_tail, engine->request_tail + 1, __ATOMIC_RELEASE);
+
+            bool is_failed = (engine->store != NULL)
+                ? telit_store_publish(engine->store, topic, payload)
+                : mqtt_publish(topic, payload);
+
+            telit_engine_response_t* response = engine_response_begin(engine, TELIT_ENGINE_PUBLISH, token);
+            response->result = is_failed ? TELIT_RESULT_ERROR : TELIT_RESULT_OK;
+            engine_response_end(engine);
+            engine->requests_done++;
+
+            engine_read_messages(engine);
+        }
+        is_busy = true;
+    }
+
+    if (engine->on_step != NULL) engine->on_step(engine, engine->user);
+
+    is_busy = is_busy || !telit_is_idle();
+    mqtt_select(selected_client);
+    telit_select(selected);
+    return is_busy;
+}
+
+/**
+ * @brief Starts the engine and steps it until telit_engine_stop(). It
+ * sleeps while there is nothing to do; a byte from the modem, or the wake
+ * hook of a request, ends the sleep. It is the main loop of the modem core.
+ */
+void telit_engine_run(telit_engine_t* engine) {
+    telit_engine_start(engine);
+
+    while (engine->is_running) {
+        if (!telit_engine_step(engine)) {
+            telit_modem_t* selected = telit_select(engine->modem);
+            telit_wait_ms(TELIT_ENGINE_IDLE_MS);
+            telit_select(selected);
+        }
+    }
+}
@@ -0,0 +1,341 @@
+#include <string.h>
+
+#include "telit_parser.h"
+#include "telit_urc.h"
+
+// Unsolicited result codes of the modem, they are never a part of an answer.
+static const char* const known_urcs[] = {
+    "#MQRING",
+    "+CREG",
+    "+CGREG",
+    "+CEREG",
+    "NO CARRIER",
+    "RING",
+};
+
+static void parser_reset_line(telit_parser_t* parser) {
+    telit_event_t* event = &parser->event;
+
+    parser->received = 0;
+    parser->in_fields = false;
+    parser->in_quotes = false;
+    parser->negative = false;
+    parser->skip_space = false;
+    parser->is_fields_full = false;
+    event->tag_length = 0;
+    event->field_count = 0;
+    event->numeric = 0;
+}
+
+static void parser_start_field(telit_parser_t* parser, uint16_t offset) {
+    telit_event_t* event = &parser->event;
+
+    event->fields[event->field_count] = 0;
+    event->field_offsets[event->field_count] = offset;
+    event->numeric |= 1u << event->field_count;
+    event->field_count++;
+    parser->negative = false;
+}
+
+static void parser_end_field(telit_parser_t* parser) {
+    telit_event_t* event = &parser->event;
+    if (event->field_count == 0) return;
+
+    uint8_t index = event->field_count - 1;
+    bool is_empty = event->field_offsets[index] == parser->received;
+
+    if (!(event->numeric & (1u << index)) || is_empty) {
+        event->numeric &= ~(1u << index);
+        event->fields[index] = 0;
+    } else if (parser->negative) {
+        event->fields[index] = -event->fields[index];
+    }
+}
+
+/**
+ * @brief Decodes a character of the fields, e.g. of "12,0" in "+CSQ: 12,0".
+ * Numbers are accumulated as they arrive, so nothing is parsed twice.
+ */
+static void parser_field_char(telit_parser_t* parser, char received_char) {
+    telit_event_t* event = &parser->event;
+    uint8_t index = event->field_count - 1;
+
+    if (parser->in_quotes) {
+        if (received_char == '"') parser->in_quotes = false;
+        return;
+    }
+
+    // Fields after the last one are not decoded.
+    if (parser->is_fields_full) return;
+
+    if (received_char == ',') {
+        parser_end_field(parser);
+        if (event->field_count == TELIT_PARSER_MAX_FIELDS)
+            parser->is_fields_full = true;
+        else
+            parser_start_field(parser, parser->received + 1);
+    }
+    else if (received_char >= '0' && received_char <= '9') {
+        event->fields[index] = event->fields[index] * 10 + (received_char - '0');
+    }
+    else if (received_char == '-' && event->field_offsets[index] == parser->received) {
+        parser->negative = true;
+    }
+    else {
+        if (received_char == '"') parser->in_quotes = true;
+        event->numeric &= ~(1u << index);
+    }
+}
+
+static bool parser_is_urc(const telit_parser_t* parser, const telit_event_t* event) {
+    if (parser->urcs != NULL && telit_urc_is_registered(parser->urcs, event))
+        return true;
+
+    for (size_t i = 0; i < sizeof(known_urcs) / sizeof(known_urcs[0]); i++) {
+        size_t length = strlen(known_urcs[i]);
+        if (strncmp(event->line, known_urcs[i], length) == 0
+            && (event->line[length] == ':' || event->line[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief The line carries the tag of the pending command, e.g. "+CREG: 0,1"
+ * for "+CREG?". If the tag is a URC too, only the lines after the echo are
+ * the answer; "+CREG: 5" before it is a URC.
+ */
+static bool parser_is_answer(const telit_parser_t* parser, const telit_event_t* event) {
+    if (!parser->is_command_pending || parser->tag[0] == '\0' || !telit_event_is(event, parser->tag))
+        return false;
+
+    return !parser->is_echo_pending || !parser_is_urc(parser, event);
+}
+
+static void parser_emit_line(telit_parser_t* parser) {
+    telit_event_t* event = &parser->event;
+    uint16_t stored = (parser->received < TELIT_PARSER_LINE_SIZE) ? parser->received : TELIT_PARSER_LINE_SIZE - 1;
+
+    if (parser->in_fields && !parser->is_fields_full) parser_end_field(parser);
+    parser->line[stored] = '\0';
+    event->line = parser->line;
+    event->length = stored;
+    event->result = TELIT_RESULT_OK;
+
+    bool is_at = (parser->line[0] == 'A' || parser->line[0] == 'a') && (parser->line[1] == 'T' || parser->line[1] == 't');
+
+    if (parser->is_echo_pending && is_at) {
+        event->type = TELIT_EVENT_ECHO;
+        parser->is_echo_pending = false;
+    }
+    else if (strcmp(parser->line, "OK") == 0) {
+        event->type = TELIT_EVENT_FINAL;
+    }
+    else if (strcmp(parser->line, "ERROR") == 0) {
+        event->type = TELIT_EVENT_FINAL;
+        event->result = TELIT_RESULT_ERROR;
+    }
+    else if (telit_event_is(event, "+CME ERROR")) {
+        event->type = TELIT_EVENT_FINAL;
+        event->result = TELIT_RESULT_CME_ERROR;
+    }
+    else if (telit_event_is(event, "+CMS ERROR")) {
+        event->type = TELIT_EVENT_FINAL;
+        event->result = TELIT_RESULT_CMS_ERROR;
+    }
+    else if (parser_is_answer(parser, event)) {
+        event->type = TELIT_EVENT_INFO;
+    }
+    else if (parser_is_urc(parser, event) || !parser->is_command_pending) {
+        event->type = TELIT_EVENT_URC;
+    }
+    else {
+        event->type = TELIT_EVENT_INFO;
+    }
+
+    if (event->type == TELIT_EVENT_FINAL) {
+        parser->is_command_pending = false;
+        parser->is_echo_pending = false;
+    }
+
+    parser->callback(event, parser->user);
+    parser_reset_line(parser);
+}
+
+static void parser_line_char(telit_parser_t* parser, char received_char) {
+    telit_event_t* event = &parser->event;
+
+    if (received_char == '\r' || received_char == '\n') {
+        if (parser->received > 0) parser_emit_line(parser);
+        return;
+    }
+
+    // "> " at the beginning of a line, the modem waits for the data.
+    if (parser->received == 0 && received_char == '>' && parser->is_command_pending) {
+        telit_event_t prompt = { .type = TELIT_EVENT_PROMPT, .line = ">", .length = 1 };
+        parser->skip_space = true;
+        parser->callback(&prompt, parser->user);
+        return;
+    }
+    if (parser->received == 0 && received_char == ' ' && parser->skip_space) {
+        parser->skip_space = false;
+        return;
+    }
+
+    if (parser->received < TELIT_PARSER_LINE_SIZE - 1)
+        parser->line[parser->received] = received_char;
+
+    if (parser->in_fields) {
+        // The space after the tag belongs to no field.
+        if (parser->skip_space && received_char == ' ') {
+            parser->skip_space = false;
+            event->field_offsets[0]++;
+        } else {
+            parser->skip_space = false;
+            parser_field_char(parser, received_char);
+        }
+    }
+    else if (received_char == ':' && parser->received < UINT8_MAX && !(parser->line[0] == 'A' && parser->line[1] == 'T')) {
+        event->tag_length = parser->received;
+        parser->in_fields = true;
+        parser->skip_space = true;
+        parser->received++;
+        parser_start_field(parser, parser->received);
+        return;
+    }
+
+    parser->received++;
+}
+
+void telit_parser_init(telit_parser_t* parser, telit_event_callback_t callback, void* user) {
+    memset(parser, 0, sizeof(*parser));
+    parser->state = TELIT_PARSER_LINE;
+    parser->callback = callback;
+    parser->user = user;
+}
+
+/**
+ * @brief Lines of the tags in the table are always URCs, even while a
+ * command is waiting for its answer.
+ */
+void telit_parser_set_urcs(telit_parser_t* parser, const struct telit_urc_table* urcs) {
+    parser->urcs = urcs;
+}
+
+/**
+ * @brief Tells the parser a command is sent. Its echo, and the lines
+ * carrying its tag (e.g. "+CREG" for "+CREG?") until the final result code
+ * belong to it.
+ *
+ * @param command The command without "AT", it may end with CR+LF.
+ */
+void telit_parser_expect(telit_parser_t* parser, const char* command) {
+    size_t length = strcspn(command, "=?\r");
+    if (length > sizeof(parser->tag) - 1) length = sizeof(parser->tag) - 1;
+
+    memcpy(parser->tag, command, length);
+    parser->tag[length] = '\0';
+    parser->is_command_pending = true;
+    parser->is_echo_pending = true;
+}
+
+/**
+ * @brief The next raw bytes after "<<<" are the data of the information
+ * response which has just been received, e.g. the payload of #MQREAD.
+ * They are given as DATA events without copying.
+ */
+void telit_parser_expect_data(telit_parser_t* parser, uint32_t length) {
+    if (length == 0) return;
+
+    parser->state = TELIT_PARSER_DATA_MARKER;
+    parser->data_remaining = length;
+    parser->marker_index = 0;
+}
+
+/**
+ * @brief Tokenizes the received bytes. The callback is called for every
+ * event as soon as its last byte is fed; the cost is linear in the bytes.
+ * It stops where raw data starts, so the caller can see it in one piece.
+ *
+ * @return size_t The number of the bytes taken, the rest is to be fed again.
+ */
+size_t telit_parser_feed(telit_parser_t* parser, const uint8_t* data, size_t length) {
+    size_t index = 0;
+
+    while (index < length) {
+        if (parser->state == TELIT_PARSER_DATA) {
+            size_t chunk = parser->data_remaining;
+            if (chunk > length - index) chunk = length - index;
+            if (chunk > UINT16_MAX) chunk = UINT16_MAX;
+
+            parser->data_remaining -= chunk;
+            if (parser->data_remaining == 0) parser->state = TELIT_PARSER_LINE;
+
+            telit_event_t event = { .type = TELIT_EVENT_DATA, .line = (const char*) data + index, .length = chunk };
+            index += chunk;
+            parser->callback(&event, parser->user);
+            continue;
+        }
+
+        char received_char = (char) data[index];
+
+        if (parser->state == TELIT_PARSER_DATA_MARKER) {
+            if (received_char == '<' && parser->marker_index < 3) {
+                parser->marker_index++;
+                index++;
+                continue;
+            }
+            if (parser->marker_index == 0 && (received_char == '\r' || received_char == '\n')) {
+                index++;
+                continue;
+            }
+            // The data starts here.
+            parser->state = TELIT_PARSER_DATA;
+            return index;
+        }
+
+        parser_line_char(parser, received_char);
+        index++;
+    }
+
+    return index;
+}
+
+bool telit_event_is(const telit_event_t* event, const char* tag) {
+    size_t length = strlen(tag);
+    return event->tag_length == length && strncmp(event->line, tag, length) == 0;
+}
+
+bool telit_event_is_number(const telit_event_t* event, uint8_t index) {
+    return index < event->field_count && (event->numeric & (1u << index));
+}
+
+/**
+ * @brief Gives a field of the line, without the quotes around it.
+ *
+ * @param length Length of the field.
+ * @return const char* The field in the line, it is not terminated. NULL
+ * if the line has no such field, or it is cut.
+ */
+const char* telit_event_field(const telit_event_t* event, uint8_t index, uint16_t* length) {
+    *length = 0;
+    if (index >= event->field_count || event->field_offsets[index] >= event->length)
+        return NULL;
+
+    const char* start = event->line + event->field_offsets[index];
+    const char* end = start;
+    bool in_quotes = false;
+
+    while (*end != '\0' && (in_quotes || *end != ',')) {
+        if (*end == '"') in_quotes = !in_quotes;
+        end++;
+    }
+
+    if (end - start >= 2 && start[0] == '"' && end[-1] == '"') {
+        start++;
+        end--;
+    }
+
+    *length = end - start;
+    return start;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telit.h"
+#include "telit_query.h"
+
+_Static_assert(TELIT_QUERY_MAX_FIELDS <= TELIT_PARSER_MAX_FIELDS, "A query can't keep more fields than the parser decodes");
+
+// Commands of the queries and the schema of their answers.
+const telit_query_t telit_queries[TELIT_QUERY_COUNT] = {
+    [TELIT_QUERY_SIGNAL]        = { TELIT_CMD_CSQ,              "+CSQ",     2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_CARRIER]       = { TELIT_CMD_CREG_READ,        "+CREG",    2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_GPRS]          = { TELIT_CMD_CGREG_READ,       "+CGREG",   2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_GPRS_ATTACH]   = { TELIT_CMD_CGATT_READ,       "+CGATT",   1, 0x1, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_APN]           = { TELIT_CMD_CGDCONT,          NULL,       0, 0x0, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_PDP]           = { TELIT_CMD_SGACT_READ,       "#SGACT",   2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_PDP_ACTIVATE]  = { TELIT_CMD_SGACT_ACTIVATE,   "#SGACT",   1, 0x0,  0, TELIT_MSG_WAIT_MS * 3 },
+    [TELIT_QUERY_MQTT_ENABLED]  = { TELIT_CMD_MQEN_READ,        "#MQEN",    2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_MQTT_WILL]     = { TELIT_CMD_MQWCFG_READ,      "#MQWCFG",  2, 0x3, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_MQTT_CONFIG]   = { TELIT_CMD_MQCFG_READ,       "#MQCFG",   3, 0x5,  1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_MQTT_SESSION]  = { TELIT_CMD_MQCFG2_READ,      "#MQCFG2",  3, 0x7, -1, TELIT_MSG_WAIT_MS },
+    [TELIT_QUERY_MQTT_STATUS]   = { TELIT_CMD_MQCONN_READ,      "#MQCONN",  2, 0x3, -1, TELIT_MSG_WAIT_MS },
+};
+
+/**
+ * @brief Writes the line of the query with telit_cmd_begin(), in one pass
+ * from its prefix; it is sent with send_command_to_telit().
+ *
+ * @param arg The argument, e.g. the APN; it is put in quotes. NULL for none.
+ * @param line Where the line is written, e.g. of TELIT_COMMAND_LINE_SIZE.
+ * @return true The command doesn't fit in the buffer.
+ * @return false The line is written.
+ */
+bool telit_query_command(telit_query_id_t id, const char* arg, telit_cmd_t* cmd, char* line, uint16_t size) {
+    telit_cmd_begin(cmd, line, size, telit_queries[id].command);
+    if (arg != NULL) {
+        telit_cmd_arg(cmd, "\"");
+        telit_cmd_append(cmd, arg);
+        telit_cmd_append(cmd, "\"");
+    }
+
+    return telit_cmd_end(cmd);
+}
+
+/**
+ * @brief Checks the answer of the query against its schema, and fills the
+ * result with its fields. It is also the completion of a submitted query.
+ *
+ * @param info The information response, NULL if there is none.
+ * @return true The command failed, or its answer doesn't fit the schema.
+ * @return false The result is filled.
+ */
+bool telit_query_decode(telit_query_id_t id, telit_result_t result, const telit_event_t* info, telit_query_result_t* answer) {
+    const telit_query_t* query = &telit_queries[id];
+
+    answer->result = result;
+    answer->field_count = 0;
+    answer->text[0] = '\0';
+
+    if (result != TELIT_RESULT_OK) return true;
+    if (query->tag == NULL) return false;
+
+    if (info == NULL || !telit_event_is(info, query->tag) || info->field_count < query->min_fields
+        || (info->numeric & query->numbers) != query->numbers)
+        return true;
+
+    answer->field_count = (info->field_count < TELIT_QUERY_MAX_FIELDS) ? info->field_count : TELIT_QUERY_MAX_FIELDS;
+    memcpy(answer->numbers, info->fields, answer->field_count * sizeof(answer->numbers[0]));
+
+    if (query->text_field >= 0) {
+        uint16_t length;
+        const char* text = telit_event_field(info, query->text_field, &length);
+        if (text == NULL || length >= sizeof(answer->text)) return true;
+
+        memcpy(answer->text, text, length);
+        answer->text[length] = '\0';
+    }
+
+    return false;
+}
+
+/**
+ * @brief Sends the query, waits for its answer, and decodes it.
+ *
+ * @param arg The argument, e.g. the APN. NULL for none.
+ * @return true The command failed, or its answer doesn't fit the schema.
+ * @return false The result is filled.
+ */
+bool telit_query(telit_query_id_t id, const char* arg, telit_query_result_t* answer) {
+    char line[TELIT_COMMAND_LINE_SIZE];
+    telit_cmd_t cmd;
+
+    if (telit_query_command(id, arg, &cmd, line, sizeof(line)) || send_command_to_telit(&cmd)) {
+        answer->result = TELIT_RESULT_ERROR;
+        return true;
+    }
+    telit_result_t result = telit_wait_final(telit_queries[id].timeout_ms);
+    bool is_failed = telit_query_decode(id, result, telit_last_info(), answer);
+
+    #ifdef DETAILED_PRINT
+        const telit_event_t* info = telit_last_info();
+        printf("\n==== %.*s ====\n", cmd.length - 2, cmd.buffer);
+        if (info != NULL) printf("-- returned message: %s\n", info->line);
+        printf("-- RESULT: %s", is_failed ? "err" : "ok");
+        for (uint8_t i = 0; i < answer->field_count; i++) printf(" %ld", (long) answer->numbers[i]);
+        printf("\n");
+    #endif
+
+    return is_failed;
+}
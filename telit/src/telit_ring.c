@@ -0,0 +1,62 @@
+#include <string.h>
+
+#include "telit_ring.h"
+
+/**
+ * @brief Initilize the ring on the given storage.
+ *
+ * @param size Size of the storage. It has to be a power of two.
+ * @return true The size is not a power of two.
+ * @return false The ring is ready.
+ */
+bool telit_ring_init(telit_ring_t* ring, uint8_t* storage, uint32_t size) {
+    if (size == 0 || (size & (size - 1)) != 0) return true;
+
+    ring->data = storage;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->overflows = 0;
+    return false;
+}
+
+/**
+ * @brief Consumer side. Copies up to the given length out of the ring.
+ *
+ * @return size_t The number of the bytes copied.
+ */
+size_t telit_ring_pop(telit_ring_t* ring, uint8_t* output, size_t length) {
+    size_t copied = 0;
+
+    while (copied < length) {
+        const uint8_t* data;
+        size_t available = telit_ring_peek(ring, &data);
+        if (available == 0) break;
+        if (available > length - copied) available = length - copied;
+
+        memcpy(output + copied, data, available);
+        telit_ring_consume(ring, available);
+        copied += available;
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Consumer side. Gives the longest contiguous readable part of the
+ * ring without copying it. It stays valid until it is consumed.
+ *
+ * @return size_t Length of the part.
+ */
+size_t telit_ring_peek(telit_ring_t* ring, const uint8_t** data) {
+    uint32_t tail = ring->tail;
+    uint32_t count = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t until_wrap = ring->mask + 1 - (tail & ring->mask);
+
+    *data = ring->data + (tail & ring->mask);
+    return (count < until_wrap) ? count : until_wrap;
+}
+
+void telit_ring_consume(telit_ring_t* ring, size_t length) {
+    __atomic_store_n(&ring->tail, ring->tail + (uint32_t) length, __ATOMIC_RELEASE);
+}
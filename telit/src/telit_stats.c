@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telit_stats.h"
+
+void telit_stats_init(telit_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->pending = -1;
+}
+
+static int16_t stats_index_of(telit_stats_t* stats, const char* tag) {
+    for (uint8_t i = 0; i < stats->command_count; i++)
+        if (strcmp(stats->commands[i].tag, tag) == 0) return i;
+
+    if (stats->command_count == TELIT_STATS_MAX_COMMANDS || strlen(tag) >= TELIT_URC_TAG_SIZE)
+        return -1;
+
+    telit_command_stats_t* command = &stats->commands[stats->command_count];
+    memset(command, 0, sizeof(*command));
+    strcpy(command->tag, tag);
+    return stats->command_count++;
+}
+
+/**
+ * @brief Starts timing a command which has just been written. A command
+ * still pending is forgotten, its answer is not waited for anymore.
+ *
+ * @param tag The type of the command, e.g. "#MQPUBS".
+ */
+void telit_stats_begin(telit_stats_t* stats, const char* tag, uint64_t now_us) {
+    stats->pending = stats_index_of(stats, tag);
+    stats->started_us = now_us;
+    if (stats->pending < 0) stats->untracked++;
+}
+
+/**
+ * @brief Counts the result of the pending command. A final result code
+ * which comes after the timeout is not counted again.
+ */
+void telit_stats_end(telit_stats_t* stats, telit_result_t result, uint64_t now_us) {
+    if (stats->pending < 0) return;
+
+    telit_command_stats_t* command = &stats->commands[stats->pending];
+    stats->pending = -1;
+    command->count++;
+
+    if (result == TELIT_RESULT_TIMEOUT) {
+        command->timeouts++;
+        return;
+    }
+    if (result == TELIT_RESULT_ERROR) command->errors++;
+    else if (result != TELIT_RESULT_OK) command->cme_errors++;
+
+    uint32_t elapsed_ms = (now_us - stats->started_us) / 1000;
+    if (elapsed_ms > command->max_ms) command->max_ms = elapsed_ms;
+    command->total_ms += elapsed_ms;
+
+    // The bucket is the number of the bits of the latency.
+    uint8_t bucket = 0;
+    while (bucket < TELIT_STATS_BUCKETS - 1 && (elapsed_ms >> bucket) != 0)
+        bucket++;
+    command->buckets[bucket]++;
+}
+
+const telit_command_stats_t* telit_stats_find(const telit_stats_t* stats, const char* tag) {
+    for (uint8_t i = 0; i < stats->command_count; i++)
+        if (strcmp(stats->commands[i].tag, tag) == 0) return &stats->commands[i];
+    return NULL;
+}
+
+/**
+ * @brief The latency which the given percent of the answered commands
+ * don't exceed, rounded up to the bound of its bucket.
+ *
+ * @return uint32_t In ms. UINT32_MAX if it is in the last bucket.
+ */
+uint32_t telit_stats_percentile_ms(const telit_command_stats_t* command, uint8_t percent) {
+    uint32_t answered = command->count - command->timeouts;
+    if (answered == 0) return 0;
+
+    uint64_t wanted = ((uint64_t) answered * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    for (uint8_t bucket = 0; bucket < TELIT_STATS_BUCKETS; bucket++) {
+        seen += command->buckets[bucket];
+        if (seen >= wanted)
+            return (bucket == TELIT_STATS_BUCKETS - 1) ? UINT32_MAX : (1u << bucket);
+    }
+    return UINT32_MAX;
+}
+
+static void stats_print_bound(uint32_t ms) {
+    if (ms == UINT32_MAX) printf("%8s ", "long");
+    else printf("<%7u ", ms);
+}
+
+/**
+ * @brief Prints a line of every command type, and its histogram.
+ */
+void telit_stats_print(const telit_stats_t* stats) {
+    printf("$> %-12s %6s %6s %6s %6s %8s %8s %8s %8s\n",
+           "command", "count", "error", "cme", "tmout", "avg ms", "p90 ms", "p99 ms", "max ms");
+
+    for (uint8_t i = 0; i < stats->command_count; i++) {
+        const telit_command_stats_t* command = &stats->commands[i];
+        uint32_t answered = command->count - command->timeouts;
+        uint32_t p90 = telit_stats_percentile_ms(command, 90);
+        uint32_t p99 = telit_stats_percentile_ms(command, 99);
+
+        printf("$> %-12s %6u %6u %6u %6u %8u ", command->tag, command->count, command->errors,
+               command->cme_errors, command->timeouts, answered ? (uint32_t) (command->total_ms / answered) : 0);
+        stats_print_bound(p90);
+        stats_print_bound(p99);
+        printf("%8u\n", command->max_ms);
+
+        // "<1:0 <2:3 <4:10 ..." up to the last bucket used.
+        int8_t last = TELIT_STATS_BUCKETS - 1;
+        while (last >= 0 && command->buckets[last] == 0) last--;
+        printf("$>   ");
+        for (int8_t bucket = 0; bucket <= last; bucket++) {
+            if (bucket == TELIT_STATS_BUCKETS - 1) printf(">=%u:%u", 1u << (bucket - 1), command->buckets[bucket]);
+            else printf("<%u:%u ", 1u << bucket, command->buckets[bucket]);
+        }
+        printf("\n");
+    }
+
+    if (stats->untracked > 0)
+        printf("$> %u commands of other types are not tracked.\n", stats->untracked);
+}
+
+/**
+ * @brief Writes the counters as a compact text to publish, e.g.
+ * "+CREG:12,0,0,0,45;#MQPUBS:..." with count, errors, CME errors,
+ * timeouts and the max latency in ms of every command type.
+ *
+ * @return size_t The length of the text; the types which don't fit are left out.
+ */
+size_t telit_stats_format(const telit_stats_t* stats, char* buffer, size_t size) {
+    size_t length = 0;
+    if (size == 0) return 0;
+    buffer[0] = '\0';
+
+    for (uint8_t i = 0; i < stats->command_count; i++) {
+        const telit_command_stats_t* command = &stats->commands[i];
+        int written = snprintf(buffer + length, size - length, "%s%s:%u,%u,%u,%u,%u", (length > 0) ? ";" : "",
+                               command->tag, command->count, command->errors, command->cme_errors,
+                               command->timeouts, command->max_ms);
+        if (written < 0 || (size_t) written >= size - length) {
+            buffer[length] = '\0';
+            break;
+        }
+        length += written;
+    }
+
+    return length;
+}
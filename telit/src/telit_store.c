@@ -0,0 +1,332 @@
+#include <string.h>
+
+#include "telit.h"
+#include "telit_store.h"
+
+/*
+* Layout of a page:
+*   0  magic            2 bytes
+*   2  state            0xFF waiting, 0x00 sent
+*   3  topic length     1 byte
+*   4  sequence         4 bytes
+*   8  payload length   2 bytes
+*   10 checksum         2 bytes, Fletcher-16 of the bytes from 3 except itself
+*   12 topic, payload
+*/
+#define STORE_MAGIC 0x5354
+#define STORE_HEADER_SIZE 12
+#define STORE_STATE_WAITING 0xFF
+#define STORE_STATE_SENT 0x00
+
+typedef struct store_record {
+    uint8_t     state;
+    uint8_t     topic_length;
+    uint32_t    sequence;
+    uint16_t    payload_length;
+} store_record_t;
+
+static uint16_t store_checksum(const uint8_t* page, uint16_t length) {
+    uint16_t sum1 = 0, sum2 = 0;
+
+    for (uint16_t i = 3; i < length; i++) {
+        if (i == 10 || i == 11) continue;
+        sum1 = (sum1 + page[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+/**
+ * @brief Decodes the header of the page.
+ *
+ * @return true The page holds no message, or a broken one.
+ */
+static bool store_decode(const telit_store_t* store, const uint8_t* page, store_record_t* record) {
+    if ((page[0] | page[1] << 8) != STORE_MAGIC) return true;
+
+    record->state = page[2];
+    record->topic_length = page[3];
+    record->sequence = page[4] | page[5] << 8 | page[6] << 16 | (uint32_t) page[7] << 24;
+    record->payload_length = page[8] | page[9] << 8;
+
+    uint32_t length = STORE_HEADER_SIZE + record->topic_length + record->payload_length;
+    if (length > store->backend->page_size) return true;
+
+    return store_checksum(page, length) != (page[10] | page[11] << 8);
+}
+
+static bool store_read(telit_store_t* store, uint32_t page, uint8_t* data) {
+    if (store->backend->read(store->backend->user, page, data)) {
+        store->failures++;
+        return true;
+    }
+    return false;
+}
+
+static bool store_is_waiting(telit_store_t* store, uint32_t page) {
+    uint8_t data[TELIT_STORE_PAGE_SIZE];
+    store_record_t record;
+
+    return !store_read(store, page, data) && !store_decode(store, data, &record)
+        && record.state == STORE_STATE_WAITING;
+}
+
+/**
+ * @brief The first waiting message from the given page up to the head.
+ */
+static uint32_t store_find_waiting(telit_store_t* store, uint32_t page) {
+    for (; page % store->page_count != store->head_page; page++)
+        if (store_is_waiting(store, page % store->page_count)) return page % store->page_count;
+    return store->head_page;
+}
+
+/**
+ * @brief Finds the head and the tail from the sequence numbers of the pages.
+ */
+static void store_scan(telit_store_t* store) {
+    uint8_t data[TELIT_STORE_PAGE_SIZE];
+    store_record_t record;
+    bool has_any = false, has_waiting = false;
+    uint32_t newest = 0, oldest_waiting = 0;
+
+    store->head_page = 0;
+    store->tail_page = 0;
+    store->count = 0;
+
+    for (uint32_t page = 0; page < store->page_count; page++) {
+        if (store_read(store, page, data) || store_decode(store, data, &record)) continue;
+
+        if (!has_any || (int32_t) (record.sequence - newest) > 0) {
+            newest = record.sequence;
+            store->head_page = (page + 1) % store->page_count;
+            has_any = true;
+        }
+
+        if (record.state != STORE_STATE_WAITING) continue;
+        if (!has_waiting || (int32_t) (record.sequence - oldest_waiting) < 0) {
+            oldest_waiting = record.sequence;
+            store->tail_page = page;
+            has_waiting = true;
+        }
+        store->count++;
+    }
+
+    store->next_sequence = has_any ? newest + 1 : 0;
+    if (!has_waiting) store->tail_page = store->head_page;
+}
+
+/**
+ * @brief Finds the queue in the storage, e.g. after a reboot.
+ *
+ * @param policy What to do when the queue is full.
+ * @return true The pages of the backend are bigger than TELIT_STORE_PAGE_SIZE,
+ * or there are less than two sectors.
+ * @return false The store is ready.
+ */
+bool telit_store_mount(telit_store_t* store, const telit_store_backend_t* backend, telit_store_policy_t policy) {
+    memset(store, 0, sizeof(*store));
+    if (backend->page_size > TELIT_STORE_PAGE_SIZE || backend->page_size <= STORE_HEADER_SIZE
+        || backend->pages_per_sector == 0 || backend->sector_count < 2)
+        return true;
+
+    store->backend = backend;
+    store->policy = policy;
+    store->page_count = (uint32_t) backend->pages_per_sector * backend->sector_count;
+    store_scan(store);
+    return false;
+}
+
+/**
+ * @brief Makes room at the head when it comes to a new sector. The sector
+ * is erased; if it still holds waiting messages, the policy decides.
+ *
+ * @return true The message can't be stored.
+ */
+static bool store_prepare_sector(telit_store_t* store) {
+    const telit_store_backend_t* backend = store->backend;
+    uint32_t sector = store->head_page / backend->pages_per_sector;
+    uint32_t first_page = sector * backend->pages_per_sector;
+
+    // The queue has come around to its own oldest messages.
+    if (store->count > 0 && store->tail_page / backend->pages_per_sector == sector) {
+        if (store->policy == TELIT_STORE_DROP_NEWEST) return true;
+
+        uint32_t lost = 0;
+        for (uint32_t page = first_page; page < first_page + backend->pages_per_sector; page++)
+            if (store_is_waiting(store, page)) lost++;
+
+        store->count -= lost;
+        store->dropped += lost;
+        TELIT_TRACE(STORE, TELIT_TRACE_STORE_DROP, 0, store->dropped, store->count);
+    }
+
+    if (backend->erase(backend->user, sector)) {
+        store->failures++;
+        return true;
+    }
+
+    if (store->count > 0 && store->tail_page / backend->pages_per_sector == sector)
+        store->tail_page = store_find_waiting(store, first_page + backend->pages_per_sector);
+    return false;
+}
+
+/**
+ * @brief Appends the message to the queue.
+ *
+ * @return true The message is too long for a page, it is dropped by the
+ * policy, or the backend failed.
+ * @return false The message is stored.
+ */
+bool telit_store_push(telit_store_t* store, const char* topic, const char* payload) {
+    const telit_store_backend_t* backend = store->backend;
+    size_t topic_length = strlen(topic);
+    size_t payload_length = strlen(payload);
+    uint32_t length = STORE_HEADER_SIZE + topic_length + payload_length;
+
+    if (backend == NULL || topic_length > UINT8_MAX || length > backend->page_size) {
+        store->dropped++;
+        TELIT_TRACE(STORE, TELIT_TRACE_STORE_DROP, 0, store->dropped, store->count);
+        return true;
+    }
+
+    uint8_t data[TELIT_STORE_PAGE_SIZE];
+
+    // Skip the pages which aren't blank, e.g. a write cut by a power loss.
+    for (uint32_t tries = 0; tries < store->page_count; tries++) {
+        if (store->head_page % backend->pages_per_sector == 0 && store_prepare_sector(store)) {
+            store->dropped++;
+            TELIT_TRACE(STORE, TELIT_TRACE_STORE_DROP, 0, store->dropped, store->count);
+            return true;
+        }
+
+        if (store_read(store, store->head_page, data)) return true;
+
+        bool is_blank = true;
+        for (uint16_t i = 0; i < backend->page_size && is_blank; i++)
+            is_blank = data[i] == 0xFF;
+        if (is_blank) break;
+
+        store->head_page = (store->head_page + 1) % store->page_count;
+    }
+
+    memset(data, 0xFF, backend->page_size);
+    data[0] = STORE_MAGIC & 0xFF;
+    data[1] = STORE_MAGIC >> 8;
+    data[2] = STORE_STATE_WAITING;
+    data[3] = topic_length;
+    data[4] = store->next_sequence;
+    data[5] = store->next_sequence >> 8;
+    data[6] = store->next_sequence >> 16;
+    data[7] = store->next_sequence >> 24;
+    data[8] = payload_length;
+    data[9] = payload_length >> 8;
+    memcpy(data + STORE_HEADER_SIZE, topic, topic_length);
+    memcpy(data + STORE_HEADER_SIZE + topic_length, payload, payload_length);
+
+    uint16_t checksum = store_checksum(data, length);
+    data[10] = checksum;
+    data[11] = checksum >> 8;
+
+    if (backend->program(backend->user, store->head_page, data)) {
+        store->failures++;
+        return true;
+    }
+
+    if (store->count == 0) store->tail_page = store->head_page;
+    store->head_page = (store->head_page + 1) % store->page_count;
+    store->next_sequence++;
+    store->count++;
+    store->stored++;
+    TELIT_TRACE(STORE, TELIT_TRACE_STORE_PUSH, 0, store->next_sequence - 1, store->count);
+    return false;
+}
+
+/**
+ * @brief Copies the oldest message out, without removing it.
+ *
+ * @return true The queue is empty, a buffer is too small, or the backend failed.
+ * @return false The message is copied.
+ */
+bool telit_store_peek(telit_store_t* store, char* topic, uint16_t topic_size, char* payload, uint16_t payload_size) {
+    if (store->count == 0) return true;
+
+    uint8_t data[TELIT_STORE_PAGE_SIZE];
+    store_record_t record;
+    if (store_read(store, store->tail_page, data) || store_decode(store, data, &record)) return true;
+    if (record.topic_length >= topic_size || record.payload_length >= payload_size) return true;
+
+    memcpy(topic, data + STORE_HEADER_SIZE, record.topic_length);
+    topic[record.topic_length] = '\0';
+    memcpy(payload, data + STORE_HEADER_SIZE + record.topic_length, record.payload_length);
+    payload[record.payload_length] = '\0';
+    return false;
+}
+
+/**
+ * @brief Marks the oldest message sent. Only its state byte is programmed,
+ * so nothing is erased.
+ *
+ * @return true The queue is empty, or the backend failed.
+ * @return false The message is removed.
+ */
+bool telit_store_pop(telit_store_t* store) {
+    const telit_store_backend_t* backend = store->backend;
+    if (store->count == 0) return true;
+
+    uint8_t data[TELIT_STORE_PAGE_SIZE];
+    memset(data, 0xFF, backend->page_size);
+    data[2] = STORE_STATE_SENT;
+
+    if (backend->program(backend->user, store->tail_page, data)) {
+        store->failures++;
+        return true;
+    }
+
+    store->count--;
+    store->sent++;
+    TELIT_TRACE(STORE, TELIT_TRACE_STORE_POP, 0, 0, store->count);
+    store->tail_page = store_find_waiting(store, store->tail_page + 1);
+    return false;
+}
+
+/**
+ * @brief Publishes the message, or keeps it for telit_store_forward() if it
+ * fails. While older messages are waiting, it is queued behind them to keep
+ * the order.
+ *
+ * @return true The message is lost.
+ * @return false The message is published, or stored.
+ */
+bool telit_store_publish(telit_store_t* store, const char* topic, const char* payload) {
+    if (store->count == 0 && !mqtt_publish((char*) topic, (char*) payload))
+        return false;
+
+    return telit_store_push(store, topic, payload);
+}
+
+/**
+ * @brief Publishes the waiting messages back to back, oldest first, if the
+ * MQTT session is connected. It stops at the first failure.
+ *
+ * @return uint32_t The number of the messages published.
+ */
+uint32_t telit_store_forward(telit_store_t* store) {
+    if (store->count == 0 || mqtt_connection_status() != 1) return 0;
+
+    char topic[TELIT_STORE_PAGE_SIZE];
+    char payload[TELIT_STORE_PAGE_SIZE];
+    uint32_t forwarded = 0;
+
+    while (!telit_store_peek(store, topic, sizeof(topic), payload, sizeof(payload))) {
+        if (mqtt_publish(topic, payload)) break;
+        if (telit_store_pop(store)) break;
+        forwarded++;
+    }
+
+    // A broken page would stop the queue for good, the queue is found again without it.
+    if (store->count > 0 && forwarded == 0 && !store_is_waiting(store, store->tail_page))
+        store_scan(store);
+
+    TELIT_TRACE(STORE, TELIT_TRACE_STORE_FORWARD, 0, forwarded, store->count);
+    return forwarded;
+}
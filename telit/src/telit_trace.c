@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include "telit_trace.h"
+
+_Static_assert((TELIT_TRACE_RING_SIZE & (TELIT_TRACE_RING_SIZE - 1)) == 0, "TELIT_TRACE_RING_SIZE has to be a power of two");
+
+telit_trace_t   telit_trace;                        // It holds the events until the main loop drains them.
+
+// "#T tttttttt iiii aaaa bbbbbbbb cccccccc\n"
+#define TRACE_LINE_SIZE 40
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static char* trace_hex(char* out, uint32_t value, uint8_t digits) {
+    for (int8_t i = digits - 1; i >= 0; i--) {
+        out[i] = hex_digits[value & 0xF];
+        value >>= 4;
+    }
+    out[digits] = ' ';
+    return out + digits + 1;
+}
+
+static void trace_write(const telit_trace_record_t* record, telit_trace_writer_t writer, void* user) {
+    char line[TRACE_LINE_SIZE];
+    char* out = line;
+
+    *out++ = '#';
+    *out++ = 'T';
+    *out++ = ' ';
+    out = trace_hex(out, record->time_us, 8);
+    out = trace_hex(out, record->id, 4);
+    out = trace_hex(out, record->arg0, 4);
+    out = trace_hex(out, record->arg1, 8);
+    out = trace_hex(out, record->arg2, 8);
+    out[-1] = '\n';
+
+    writer(line, out - line, user);
+}
+
+/**
+ * @brief Writes the waiting events as text lines, oldest first. It has to
+ * be called from the main loop, e.g. when it is idle; the events are
+ * formatted here, not where they happen. Records lost since the last drain
+ * are told with a TELIT_TRACE_LOST line.
+ *
+ * @param time_us The time of the drain, on the clock of the modem, for the
+ * TELIT_TRACE_LOST line. It is passed in, the drain may run on the other core.
+ * @param max_records The most events written in this call, 0 for all.
+ * @return uint32_t The number of the events written.
+ */
+uint32_t telit_trace_drain(uint32_t time_us, uint32_t max_records, telit_trace_writer_t writer, void* user) {
+    uint32_t drained = 0;
+
+    uint32_t lost = telit_trace.lost;
+    if (lost != telit_trace.lost_reported) {
+        telit_trace_record_t record = {
+            .time_us = time_us,
+            .id = TELIT_TRACE_LOST,
+            .arg1 = lost - telit_trace.lost_reported,
+        };
+        trace_write(&record, writer, user);
+        telit_trace.lost_reported = lost;
+    }
+
+    uint32_t tail = telit_trace.tail;
+    uint32_t head = __atomic_load_n(&telit_trace.head, __ATOMIC_ACQUIRE);
+
+    while (tail != head && (max_records == 0 || drained < max_records)) {
+        trace_write(&telit_trace.records[tail & (TELIT_TRACE_RING_SIZE - 1)], writer, user);
+        tail++;
+        drained++;
+    }
+
+    __atomic_store_n(&telit_trace.tail, tail, __ATOMIC_RELEASE);
+    return drained;
+}
+
+/**
+ * @brief The events waiting to be drained.
+ */
+uint32_t telit_trace_pending() {
+    return __atomic_load_n(&telit_trace.head, __ATOMIC_ACQUIRE) - telit_trace.tail;
+}
+
+static bool trace_parse_hex(const char** text, uint8_t digits, uint32_t* value) {
+    *value = 0;
+    for (uint8_t i = 0; i < digits; i++) {
+        const char* digit = ((*text)[i] == '\0') ? NULL : strchr(hex_digits, (*text)[i]);
+        if (digit == NULL) return true;
+        *value = (*value << 4) | (uint32_t) (digit - hex_digits);
+    }
+    if ((*text)[digits] != ' ' && (*text)[digits] != '\n' && (*text)[digits] != '\r' && (*text)[digits] != '\0')
+        return true;
+
+    *text += digits + 1;
+    return false;
+}
+
+/**
+ * @brief Reads a line written by telit_trace_drain() back.
+ *
+ * @return true The line is not a trace line, e.g. other console output.
+ * @return false The record is filled.
+ */
+bool telit_trace_parse(const char* line, telit_trace_record_t* record) {
+    const char* text = strstr(line, "#T ");
+    if (text == NULL) return true;
+    text += 3;
+
+    uint32_t id, arg0;
+    if (trace_parse_hex(&text, 8, &record->time_us) || trace_parse_hex(&text, 4, &id)
+        || trace_parse_hex(&text, 4, &arg0) || trace_parse_hex(&text, 8, &record->arg1)
+        || trace_parse_hex(&text, 8, &record->arg2))
+        return true;
+
+    record->id = id;
+    record->arg0 = arg0;
+    return false;
+}
+
+/**
+ * @brief The name of the event, e.g. "at.write", or NULL if it is unknown.
+ */
+const char* telit_trace_name(uint16_t id) {
+    switch (id) {
+        case TELIT_TRACE_LOST:          return "trace.lost";
+        case TELIT_TRACE_CMD_WRITE:     return "at.write";
+        case TELIT_TRACE_CMD_FINAL:     return "at.final";
+        case TELIT_TRACE_CMD_TIMEOUT:   return "at.timeout";
+        case TELIT_TRACE_PROMPT:        return "at.prompt";
+        case TELIT_TRACE_URC:           return "at.urc";
+        case TELIT_TRACE_RX_OVERFLOW:   return "at.rx_overflow";
+        case TELIT_TRACE_BAUDRATE:      return "at.baudrate";
+        case TELIT_TRACE_MQTT_PUBLISH:  return "mqtt.publish";
+        case TELIT_TRACE_MQTT_RING:     return "mqtt.ring";
+        case TELIT_TRACE_MQTT_READ:     return "mqtt.read";
+        case TELIT_TRACE_MQTT_READ_ALL: return "mqtt.read_all";
+        case TELIT_TRACE_ATTACH_EVENT:  return "attach.event";
+        case TELIT_TRACE_ATTACH_READY:  return "attach.ready";
+        case TELIT_TRACE_STORE_PUSH:    return "store.push";
+        case TELIT_TRACE_STORE_POP:     return "store.pop";
+        case TELIT_TRACE_STORE_DROP:    return "store.drop";
+        case TELIT_TRACE_STORE_FORWARD: return "store.forward";
+        default:                        return NULL;
+    }
+}
@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include "telit_urc.h"
+
+/**
+ * @brief A URC matches the tag before ':', e.g. "+CREG" of "+CREG: 5",
+ * or the whole line if it has no fields, e.g. "NO CARRIER".
+ */
+static bool urc_matches(const telit_urc_entry_t* entry, const telit_event_t* event) {
+    if (event->tag_length > 0) return telit_event_is(event, entry->tag);
+    return strcmp(event->line, entry->tag) == 0;
+}
+
+/**
+ * @brief Adds a handler for the URCs of the given tag. A tag may have
+ * more than one handler; they are called in the order of registration.
+ *
+ * @param tag e.g. "#MQRING", "+CREG" or "NO CARRIER".
+ * @return true The table is full, or the tag is too long.
+ * @return false The handler is added.
+ */
+bool telit_urc_register(telit_urc_table_t* table, const char* tag, telit_urc_handler_t handler, void* user) {
+    if (table->count == TELIT_URC_MAX_HANDLERS || strlen(tag) >= TELIT_URC_TAG_SIZE || handler == NULL)
+        return true;
+
+    telit_urc_entry_t* entry = &table->entries[table->count++];
+    strcpy(entry->tag, tag);
+    entry->handler = handler;
+    entry->user = user;
+    return false;
+}
+
+/**
+ * @brief Removes the handler of the given tag.
+ *
+ * @return true The handler is not registered.
+ * @return false The handler is removed.
+ */
+bool telit_urc_unregister(telit_urc_table_t* table, const char* tag, telit_urc_handler_t handler) {
+    for (uint8_t i = 0; i < table->count; i++) {
+        telit_urc_entry_t* entry = &table->entries[i];
+        if (entry->handler != handler || strcmp(entry->tag, tag) != 0) continue;
+
+        // Keep the order of the rest.
+        memmove(entry, entry + 1, (table->count - i - 1) * sizeof(*entry));
+        table->count--;
+        return false;
+    }
+    return true;
+}
+
+bool telit_urc_is_registered(const telit_urc_table_t* table, const telit_event_t* event) {
+    for (uint8_t i = 0; i < table->count; i++)
+        if (urc_matches(&table->entries[i], event)) return true;
+    return false;
+}
+
+/**
+ * @brief Calls every handler of the URC.
+ *
+ * @return uint8_t The number of the handlers called.
+ */
+uint8_t telit_urc_dispatch(telit_urc_table_t* table, const telit_event_t* event) {
+    uint8_t called = 0;
+
+    for (uint8_t i = 0; i < table->count; i++) {
+        telit_urc_entry_t* entry = &table->entries[i];
+        if (!urc_matches(entry, event)) continue;
+
+        entry->handler(event, entry->user);
+        called++;
+    }
+
+    if (called == 0) table->unhandled++;
+    return called;
+}